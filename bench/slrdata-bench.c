@@ -0,0 +1,666 @@
+// Benchmark of building and querying relation files on synthetic relations.
+// Prints the results as a JSON object on stdout.
+//
+// slrdata-bench [--generator bounded|powerlaw|kary] [--elements n]
+//               [--degree d] [--exponent g] [--arity k] [--tuples m]
+//               [--queries q] [--seed s] [--threads t] [--dir folder]
+//               [--layout packed|aligned|columnar] [--incidences plain|compressed]
+//               [--open plain|random|populate|warm] [--neighbors none|lists|padded]
+
+#include "../include/sl-relational-data.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+struct bench_options
+{
+	const char *generator;
+	uint_fast64_t elements;
+	uint_fast64_t degree;
+	double exponent;
+	uint_fast64_t arity;
+	uint_fast64_t tuples;
+	uint_fast64_t queries;
+	uint64_t seed;
+	unsigned threads;
+	const char *dir;
+	const char *layout;
+	const char *incidences;
+	const char *open;
+	const char *neighbors;
+};
+
+static uint64_t bench_rng;
+
+// splitmix64, good enough for generating inputs
+static uint64_t bench_random(void)
+{
+	uint64_t z = (bench_rng += 0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+}
+
+static uint64_t bench_random_below(uint64_t n)
+{
+	return (uint64_t)(((unsigned __int128)bench_random() * n) >> 64);
+}
+
+static double bench_now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static uint64_t bench_now_ns(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+// Graph where no vertex has more than degree edges: edges join two random
+// vertices that still have room until fewer than two are left or
+// elements * degree / 2 edges exist.
+static uint_fast64_t generate_bounded(struct bench_options *o, uint_fast64_t *tuples)
+{
+	uint_fast64_t *open = malloc(o->elements * sizeof(uint_fast64_t));
+	uint_fast64_t *degree = calloc(o->elements, sizeof(uint_fast64_t));
+	uint_fast64_t open_count = o->elements;
+	uint_fast64_t count = 0;
+
+	for (uint_fast64_t e = 0; e < o->elements; e++)
+		open[e] = e;
+
+	while (count < o->tuples && open_count >= 2)
+	{
+		uint_fast64_t i = bench_random_below(open_count);
+		uint_fast64_t j = bench_random_below(open_count - 1);
+		if (j >= i)
+			j++;
+
+		uint_fast64_t u = open[i], v = open[j];
+		tuples[2 * count] = u;
+		tuples[2 * count + 1] = v;
+		count++;
+
+		// remove full vertices, the larger position first
+		if (i < j)
+		{
+			uint_fast64_t swap = i;
+			i = j;
+			j = swap;
+		}
+
+		if (++degree[open[i]] == o->degree)
+			open[i] = open[--open_count];
+		if (++degree[open[j]] == o->degree)
+			open[j] = open[--open_count];
+	}
+
+	free(open);
+	free(degree);
+
+	return count;
+}
+
+// Chung-Lu graph with expected degrees following a power law with the given
+// exponent
+static uint_fast64_t generate_powerlaw(struct bench_options *o, uint_fast64_t *tuples)
+{
+	double *cdf = malloc(o->elements * sizeof(double));
+	double total = 0;
+
+	for (uint_fast64_t e = 0; e < o->elements; e++)
+	{
+		total += pow((double)(e + 1), -1.0 / (o->exponent - 1.0));
+		cdf[e] = total;
+	}
+
+	for (uint_fast64_t i = 0; i < 2 * o->tuples; i++)
+	{
+		double x = (bench_random() >> 11) * 0x1.0p-53 * total;
+		uint_fast64_t lo = 0, hi = o->elements - 1;
+
+		while (lo < hi)
+		{
+			uint_fast64_t mid = lo + (hi - lo) / 2;
+			if (cdf[mid] < x)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		tuples[i] = lo;
+	}
+
+	free(cdf);
+
+	return o->tuples;
+}
+
+// Tuples of arity elements picked uniformly at random
+static uint_fast64_t generate_kary(struct bench_options *o, uint_fast64_t *tuples)
+{
+	for (uint_fast64_t i = 0; i < o->tuples * o->arity; i++)
+		tuples[i] = bench_random_below(o->elements);
+
+	return o->tuples;
+}
+
+static uint_fast64_t file_size(const char *dir, const char *name)
+{
+	char path[4096];
+	struct stat st;
+
+	snprintf(path, sizeof(path), "%s/%s.sld", dir, name);
+	if (stat(path, &st))
+		return 0;
+
+	return st.st_size;
+}
+
+// Write back and drop the file from the page cache so the next queries are cold
+static void drop_cache(const char *dir, const char *name)
+{
+	char path[4096];
+
+	snprintf(path, sizeof(path), "%s/%s.sld", dir, name);
+	int fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return;
+
+	fdatasync(fd);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+static void print_percentiles(const char *name, uint64_t *ns, uint_fast64_t n, bool last)
+{
+	qsort(ns, n, sizeof(uint64_t), compare_u64);
+
+	printf("\t\t\t\"%s\": {\"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %llu}%s\n", name,
+			(unsigned long long)ns[n / 2], (unsigned long long)ns[n * 9 / 10], (unsigned long long)ns[n * 99 / 100],
+			(unsigned long long)ns[n * 999 / 1000], (unsigned long long)ns[n - 1], last ? "" : ",");
+}
+
+static void print_throughput(const char *name, double single, double batched, uint_fast64_t n)
+{
+	printf("\t\t\t\"%s_throughput\": {\"single_ns\": %.1f, \"batched_ns\": %.1f},\n", name, single * 1e9 / n, batched * 1e9 / n);
+}
+
+static void print_build(const char *name, double seconds, uint_fast64_t items, uint_fast64_t size, bool last)
+{
+	printf("\t\t\"%s\": {\"seconds\": %.6f, \"items_per_second\": %.0f, \"file_size\": %llu}%s\n", name,
+			seconds, seconds > 0 ? items / seconds : 0.0, (unsigned long long)size, last ? "" : ",");
+}
+
+// Time q random degree, slrdata_tuple and slrdata_read_tuple queries one by one,
+// then the time per query of the read queries issued one by one and batched
+static void bench_queries(slrdata_t *rel, struct bench_options *o, const char *name, bool last)
+{
+	uint64_t *ns = malloc(o->queries * sizeof(uint64_t));
+	uint_fast64_t *elements = malloc(o->queries * sizeof(uint_fast64_t));
+	uint_fast64_t *positions = malloc(o->queries * sizeof(uint_fast64_t));
+	uint_fast64_t tuple[rel->arity];
+	uint_fast64_t element_count = slrdata_element_count(rel);
+	uint64_t checksum = 0;
+
+	// pick the queries up front so that only the library is timed
+	for (uint_fast64_t q = 0; q < o->queries; q++)
+	{
+		elements[q] = bench_random_below(element_count);
+		positions[q] = bench_random();
+	}
+
+	printf("\t\t\"%s\": {\n", name);
+
+	for (uint_fast64_t q = 0; q < o->queries; q++)
+	{
+		uint64_t start = bench_now_ns();
+		checksum += slrdata_degree(rel, elements[q]);
+		ns[q] = bench_now_ns() - start;
+	}
+	print_percentiles("degree", ns, o->queries, false);
+
+	for (uint_fast64_t q = 0; q < o->queries; q++)
+	{
+		uint_fast64_t degree = slrdata_degree(rel, elements[q]);
+		uint_fast64_t i = degree ? positions[q] % degree : 0;
+
+		uint64_t start = bench_now_ns();
+		uint_fast64_t *t = slrdata_tuple(rel, elements[q], i);
+		ns[q] = bench_now_ns() - start;
+
+		if (t)
+			checksum += t[0];
+		free(t);
+	}
+	print_percentiles("tuple", ns, o->queries, false);
+
+	for (uint_fast64_t q = 0; q < o->queries; q++)
+	{
+		uint_fast64_t degree = slrdata_degree(rel, elements[q]);
+		uint_fast64_t i = degree ? positions[q] % degree : 0;
+
+		uint64_t start = bench_now_ns();
+		if (slrdata_read_tuple(rel, elements[q], i, tuple) == 0)
+			checksum += tuple[0];
+		ns[q] = bench_now_ns() - start;
+	}
+	print_percentiles("read_tuple", ns, o->queries, false);
+
+	// j-th neighbors of random elements of a graph with j below the average
+	// degree, new elements and no degree query first so that no line the
+	// query reads is already in the cache
+	if (rel->arity == 2)
+	{
+		for (uint_fast64_t q = 0; q < o->queries; q++)
+		{
+			uint_fast64_t e = bench_random_below(element_count);
+			uint_fast64_t i = o->degree ? bench_random() % o->degree : 0;
+
+			uint64_t start = bench_now_ns();
+			checksum += slrdata_neighbor(rel, e, i);
+			ns[q] = bench_now_ns() - start;
+		}
+		print_percentiles("neighbor", ns, o->queries, false);
+	}
+
+	for (uint_fast64_t q = 0; q < o->queries; q++)
+	{
+		uint_fast64_t i = positions[q] % slrdata_tuple_count(rel);
+
+		uint64_t start = bench_now_ns();
+		slrdata_read_ith_tuple(rel, i, tuple);
+		ns[q] = bench_now_ns() - start;
+
+		checksum += tuple[0];
+	}
+	print_percentiles("read_ith_tuple", ns, o->queries, false);
+
+	// throughput of the same requests one at a time and batched
+	uint_fast64_t *indices = malloc(o->queries * sizeof(uint_fast64_t));
+	uint_fast64_t *out = malloc(o->queries * rel->arity * sizeof(uint_fast64_t));
+	slrdata_degrees(rel, elements, o->queries, indices);
+	for (uint_fast64_t q = 0; q < o->queries; q++)
+		indices[q] = indices[q] ? positions[q] % indices[q] : 0;
+
+	double start = bench_now();
+	for (uint_fast64_t q = 0; q < o->queries; q++)
+		if (slrdata_read_tuple(rel, elements[q], indices[q], out + q * rel->arity) == 0)
+			checksum += out[q * rel->arity];
+	double single = bench_now() - start;
+
+	start = bench_now();
+	slrdata_read_tuples(rel, elements, indices, o->queries, out);
+	double batched = bench_now() - start;
+	print_throughput("read_tuple", single, batched, o->queries);
+
+	start = bench_now();
+	slrdata_parallel_read_tuples(rel, elements, indices, o->queries, out, o->threads);
+	double parallel = bench_now() - start;
+
+	start = bench_now();
+	slrdata_parallel_sample_tuples(rel, o->seed, out, o->queries, o->threads);
+	double sample = bench_now() - start;
+	printf("\t\t\t\"parallel_throughput\": {\"read_tuples_ns\": %.1f, \"sample_tuples_ns\": %.1f},\n",
+			parallel * 1e9 / o->queries, sample * 1e9 / o->queries);
+
+	for (uint_fast64_t q = 0; q < o->queries; q++)
+		indices[q] = positions[q] % slrdata_tuple_count(rel);
+
+	start = bench_now();
+	for (uint_fast64_t q = 0; q < o->queries; q++)
+		if (slrdata_read_ith_tuple(rel, indices[q], out + q * rel->arity) == 0)
+			checksum += out[q * rel->arity];
+	single = bench_now() - start;
+
+	start = bench_now();
+	slrdata_read_ith_tuples(rel, indices, o->queries, out);
+	batched = bench_now() - start;
+	print_throughput("read_ith_tuple", single, batched, o->queries);
+
+	for (uint_fast64_t q = 0; q < o->queries; q++)
+		checksum += out[q * rel->arity];
+
+	printf("\t\t\t\"checksum\": %llu\n\t\t}%s\n", (unsigned long long)checksum, last ? "" : ",");
+
+	free(ns);
+	free(elements);
+	free(positions);
+	free(indices);
+	free(out);
+}
+
+static void bench_scans(slrdata_t *rel)
+{
+	uint64_t block[4096];
+	uint64_t checksum = 0;
+	uint_fast64_t count = slrdata_tuple_count(rel);
+	uint_fast64_t per_block = sizeof(block) / sizeof(block[0]) / rel->arity;
+
+	double start = bench_now();
+	for (uint_fast64_t first = 0; first < count; first += per_block)
+	{
+		uint_fast64_t n = slrdata_scan_tuples(rel, first, per_block, block);
+		for (uint_fast64_t j = 0; j < n * rel->arity; j++)
+			checksum += block[j];
+	}
+	double scan_seconds = bench_now() - start;
+
+	start = bench_now();
+	for (uint_fast64_t first = 0; first < count; first += sizeof(block) / sizeof(block[0]))
+	{
+		uint_fast64_t n = slrdata_scan_column(rel, 0, first, sizeof(block) / sizeof(block[0]), block);
+		for (uint_fast64_t j = 0; j < n; j++)
+			checksum += block[j];
+	}
+	double column_seconds = bench_now() - start;
+
+	slrdata_cursor_t c;
+	uint_fast64_t tuple[rel->arity];
+	start = bench_now();
+	slrdata_tuple_cursor(rel, &c);
+	while (slrdata_cursor_next(&c, tuple))
+		checksum += tuple[0];
+	double cursor_seconds = bench_now() - start;
+
+	uint_fast64_t incidences = 0;
+	start = bench_now();
+	for (uint_fast64_t e = 0; e < slrdata_element_count(rel); e++)
+	{
+		slrdata_incidence_cursor(rel, e, &c);
+		while (slrdata_cursor_next(&c, tuple))
+		{
+			checksum += tuple[0];
+			incidences++;
+		}
+	}
+	double incidence_seconds = bench_now() - start;
+
+	printf("\t\"scan\": {\n");
+	printf("\t\t\"scan_tuples\": {\"seconds\": %.6f, \"tuples_per_second\": %.0f},\n", scan_seconds, scan_seconds > 0 ? count / scan_seconds : 0.0);
+	printf("\t\t\"scan_column\": {\"seconds\": %.6f, \"tuples_per_second\": %.0f},\n", column_seconds, column_seconds > 0 ? count / column_seconds : 0.0);
+	printf("\t\t\"tuple_cursor\": {\"seconds\": %.6f, \"tuples_per_second\": %.0f},\n", cursor_seconds, cursor_seconds > 0 ? count / cursor_seconds : 0.0);
+	printf("\t\t\"incidence_cursor\": {\"seconds\": %.6f, \"tuples_per_second\": %.0f},\n", incidence_seconds, incidence_seconds > 0 ? incidences / incidence_seconds : 0.0);
+	printf("\t\t\"checksum\": %llu\n\t}\n", (unsigned long long)checksum);
+}
+
+// packed 6 byte fields, or the aligned 4/8 byte layout of version 3 files
+// with the tuples stored by row or by column
+static int create_relation(struct bench_options *o, slrdata_t *rel, const char *name)
+{
+	if (!strcmp(o->layout, "aligned"))
+		return slrdata_create_aligned_relation_file(rel, o->dir, name, o->elements, o->tuples);
+	if (!strcmp(o->layout, "columnar"))
+		return slrdata_create_columnar_relation_file(rel, o->dir, name, o->elements, o->tuples);
+
+	return slrdata_create_relation_file(rel, o->dir, name);
+}
+
+// open with the hints of the --open profile, warm reads the tables every
+// query uses in right away
+static int open_relation(struct bench_options *o, slrdata_t *rel, const char *name)
+{
+	unsigned hints = 0;
+	if (!strcmp(o->open, "random") || !strcmp(o->open, "warm"))
+		hints = SLRDATA_HINT_RANDOM;
+	else if (!strcmp(o->open, "populate"))
+		hints = SLRDATA_HINT_POPULATE;
+
+	if (slrdata_open_hinted(rel, o->dir, name, true, true, hints))
+		return 1;
+	if (!strcmp(o->open, "warm"))
+		slrdata_warm_up(rel);
+
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [--generator bounded|powerlaw|kary] [--elements n] [--degree d] [--exponent g]\n"
+			"       [--arity k] [--tuples m] [--queries q] [--seed s] [--threads t] [--dir folder]\n"
+			"       [--layout packed|aligned|columnar] [--incidences plain|compressed]\n"
+			"       [--open plain|random|populate|warm] [--neighbors none|lists|padded]\n", name);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	struct bench_options o = { "bounded", 100000, 8, 2.5, 2, 0, 100000, 1, sysconf(_SC_NPROCESSORS_ONLN), NULL, "packed", "plain", "plain", "none" };
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 == argc)
+			usage(argv[0]);
+
+		if (!strcmp(argv[i], "--generator"))
+			o.generator = argv[++i];
+		else if (!strcmp(argv[i], "--elements"))
+			o.elements = strtoull(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "--degree"))
+			o.degree = strtoull(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "--exponent"))
+			o.exponent = strtod(argv[++i], NULL);
+		else if (!strcmp(argv[i], "--arity"))
+			o.arity = strtoull(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "--tuples"))
+			o.tuples = strtoull(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "--queries"))
+			o.queries = strtoull(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "--seed"))
+			o.seed = strtoull(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "--threads"))
+			o.threads = strtoul(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "--dir"))
+			o.dir = argv[++i];
+		else if (!strcmp(argv[i], "--layout"))
+			o.layout = argv[++i];
+		else if (!strcmp(argv[i], "--incidences"))
+			o.incidences = argv[++i];
+		else if (!strcmp(argv[i], "--neighbors"))
+			o.neighbors = argv[++i];
+		else if (!strcmp(argv[i], "--open"))
+			o.open = argv[++i];
+		else
+			usage(argv[0]);
+	}
+
+	bool graph = strcmp(o.generator, "kary") != 0;
+	if (graph)
+		o.arity = 2;
+	if (o.tuples == 0)
+		o.tuples = graph ? o.elements * o.degree / 2 : o.elements * o.degree / o.arity;
+	if (strcmp(o.layout, "packed") && strcmp(o.layout, "aligned") && strcmp(o.layout, "columnar"))
+		usage(argv[0]);
+	if (strcmp(o.incidences, "plain") && strcmp(o.incidences, "compressed"))
+		usage(argv[0]);
+	if (strcmp(o.open, "plain") && strcmp(o.open, "random") && strcmp(o.open, "populate") && strcmp(o.open, "warm"))
+		usage(argv[0]);
+	if (strcmp(o.neighbors, "none") && ((strcmp(o.neighbors, "lists") && strcmp(o.neighbors, "padded")) || o.arity != 2))
+		usage(argv[0]);
+	if (o.elements < 2 || o.arity == 0 || o.tuples == 0 || o.queries == 0 || (strcmp(o.generator, "powerlaw") == 0 && o.exponent <= 1.0))
+		usage(argv[0]);
+
+	char dir[] = "/tmp/slrdata-bench-XXXXXX";
+	if (o.dir == NULL)
+	{
+		if (mkdtemp(dir) == NULL)
+			return 1;
+		o.dir = dir;
+	}
+	else if (slrdata_create_directory(o.dir))
+	{
+		fprintf(stderr, "%s: cannot create %s\n", argv[0], o.dir);
+		return 1;
+	}
+
+	bench_rng = o.seed;
+	uint_fast64_t *tuples = malloc(o.tuples * o.arity * sizeof(uint_fast64_t));
+	if (!strcmp(o.generator, "bounded"))
+		o.tuples = generate_bounded(&o, tuples);
+	else if (!strcmp(o.generator, "powerlaw"))
+		o.tuples = generate_powerlaw(&o, tuples);
+	else if (!strcmp(o.generator, "kary"))
+		o.tuples = generate_kary(&o, tuples);
+	else
+		usage(argv[0]);
+
+	slrdata_t elements, rel;
+	double start, seconds;
+
+	printf("{\n");
+	printf("\t\"generator\": \"%s\",\n\t\"elements\": %llu,\n\t\"tuples\": %llu,\n\t\"arity\": %llu,\n\t\"seed\": %llu,\n\t\"threads\": %u,\n\t\"layout\": \"%s\",\n\t\"incidences\": \"%s\",\n\t\"open\": \"%s\",\n\t\"neighbors\": \"%s\",\n",
+			o.generator, (unsigned long long)o.elements, (unsigned long long)o.tuples, (unsigned long long)o.arity, (unsigned long long)o.seed, o.threads, o.layout, o.incidences, o.open, o.neighbors);
+	printf("\t\"build\": {\n");
+
+	start = bench_now();
+	if (slrdata_create_element_file(&elements, o.dir) || slrdata_add_elements(&elements, NULL, o.elements))
+		return 1;
+	seconds = bench_now() - start;
+	print_build("add_elements", seconds, o.elements, elements.size, false);
+
+	// one tuple at a time
+	start = bench_now();
+	if (create_relation(&o, &rel, "add_tuple"))
+		return 1;
+	for (uint_fast64_t i = 0; i < o.tuples; i++)
+		if (slrdata_add_tuple(&rel, tuples + i * o.arity, o.arity))
+			return 1;
+	seconds = bench_now() - start;
+	print_build("add_tuple", seconds, o.tuples, rel.size, false);
+
+	// incidence lists with slack, then compacted
+	start = bench_now();
+	if (slrdata_add_incidence_lists(&rel, &elements, 4, -1))
+		return 1;
+	seconds = bench_now() - start;
+	print_build("add_incidence_lists", seconds, o.tuples * o.arity, rel.size, false);
+
+	start = bench_now();
+	if (slrdata_reduce_size(&rel))
+		return 1;
+	seconds = bench_now() - start;
+	slrdata_close(&rel);
+	print_build("reduce_size", seconds, o.tuples * o.arity, file_size(o.dir, "add_tuple"), false);
+
+	// bulk
+	start = bench_now();
+	if (create_relation(&o, &rel, "add_tuples") || slrdata_add_tuples(&rel, tuples, o.tuples, o.arity))
+		return 1;
+	seconds = bench_now() - start;
+	print_build("add_tuples", seconds, o.tuples, rel.size, false);
+
+	start = bench_now();
+	if (slrdata_build_incidence_lists_parallel(&rel, &elements, -1, o.threads))
+		return 1;
+	seconds = bench_now() - start;
+	print_build("build_incidence_lists_parallel", seconds, o.tuples * o.arity, rel.size, false);
+	slrdata_close(&rel);
+
+	// builder, then compact incidence lists
+	slrdata_builder_t b;
+	start = bench_now();
+	if (create_relation(&o, &rel, "builder") || slrdata_builder_init(&b, &rel, o.arity))
+		return 1;
+	for (uint_fast64_t i = 0; i < o.tuples; i++)
+		if (slrdata_builder_add(&b, tuples + i * o.arity))
+			return 1;
+	if (slrdata_builder_finish(&b))
+		return 1;
+	seconds = bench_now() - start;
+	print_build("builder", seconds, o.tuples, rel.size, false);
+
+	start = bench_now();
+	if (slrdata_build_incidence_lists(&rel, &elements, -1))
+		return 1;
+	seconds = bench_now() - start;
+	bool compress = !strcmp(o.incidences, "compressed");
+	bool neighbors = strcmp(o.neighbors, "none") != 0;
+	print_build("build_incidence_lists", seconds, o.tuples * o.arity, rel.size, !compress && !neighbors);
+
+	if (compress)
+	{
+		start = bench_now();
+		if (slrdata_compress_incidence_lists(&rel))
+			return 1;
+		seconds = bench_now() - start;
+		print_build("compress_incidence_lists", seconds, o.tuples * o.arity, rel.size, !neighbors);
+	}
+
+	// padded to the largest degree for single load neighbor queries
+	if (neighbors)
+	{
+		uint_fast64_t slots = 0;
+		for (uint_fast64_t e = 0; !strcmp(o.neighbors, "padded") && e < o.elements; e++)
+			if (slrdata_degree(&rel, e) > slots)
+				slots = slrdata_degree(&rel, e);
+
+		start = bench_now();
+		if (slrdata_add_neighbor_table(&rel, slots))
+			return 1;
+		seconds = bench_now() - start;
+		print_build("add_neighbor_table", seconds, o.tuples * o.arity, rel.size, true);
+	}
+	slrdata_close(&rel);
+	slrdata_close(&elements);
+
+	printf("\t},\n");
+
+	// queries on the compact file
+	printf("\t\"queries\": {\n");
+	drop_cache(o.dir, "builder");
+	start = bench_now();
+	if (open_relation(&o, &rel, "builder"))
+		return 1;
+	seconds = bench_now() - start;
+	printf("\t\t\"open_seconds\": %.6f,\n", seconds);
+	// statistics are only gathered if the library was built with them
+	bool stats = slrdata_stats_enable(&rel) == 0;
+	bench_queries(&rel, &o, "cold", false);
+	bench_queries(&rel, &o, "warm", true);
+	printf("\t},\n");
+
+	if (stats)
+	{
+		printf("\t\"stats\": ");
+		slrdata_stats_dump(&rel, stdout);
+		printf(",\n");
+	}
+
+	bench_scans(&rel);
+	slrdata_close(&rel);
+
+	printf("}\n");
+
+	// remove the files unless the caller asked for them
+	if (o.dir == dir)
+	{
+		const char *names[] = { "elements", "add_tuple", "add_tuples", "builder" };
+		char path[4096];
+
+		for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+		{
+			snprintf(path, sizeof(path), "%s/%s.sld", dir, names[i]);
+			unlink(path);
+		}
+		rmdir(dir);
+	}
+
+	free(tuples);
+
+	return 0;
+}
@@ -1,48 +1,342 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+
+// workload hints for slrdata_open_hinted and slrdata_advise
+// random accesses: no readahead on the bulk of the file, the element list and
+// the tables used by every query are read ahead
+#define SLRDATA_HINT_RANDOM 1
+// scans and builds: aggressive readahead
+#define SLRDATA_HINT_SEQUENTIAL 2
+// read the whole file in when mapping it
+#define SLRDATA_HINT_POPULATE 4
+// back the mapping with transparent huge pages where the kernel supports it
+#define SLRDATA_HINT_HUGEPAGES 8
+// keep the element list and tables used by every query in memory with mlock
+#define SLRDATA_HINT_LOCK 16
+
+// kinds of queries counted by the statistics
+enum slrdata_stat_query
+{
+	SLRDATA_STAT_DEGREE,
+	SLRDATA_STAT_TUPLE,
+	SLRDATA_STAT_ITH_TUPLE,
+	SLRDATA_STAT_SAMPLE,
+	SLRDATA_STAT_LOOKUP,
+	SLRDATA_STAT_BATCH,
+	SLRDATA_STAT_SCAN,
+	SLRDATA_STAT_NEIGHBOR,
+	SLRDATA_STAT_COUNT
+};
+
+#define SLRDATA_STAT_BUCKETS 48
+
+// Statistics of a handle, gathered after slrdata_stats_enable if the library
+// is built with SLRDATA_STATS (make STATS=1). Without it the counting compiles
+// to nothing.
+struct slrdata_stats_t
+{
+	uint64_t resizes;
+	uint64_t remaps;
+	uint64_t remapped_bytes;
+	// calls and requests (tuples, elements, ...) per kind of query
+	uint64_t calls[SLRDATA_STAT_COUNT];
+	uint64_t queries[SLRDATA_STAT_COUNT];
+	// latencies of sampled calls, bucket b for 2^(b-1) to 2^b - 1 ns
+	uint64_t latency[SLRDATA_STAT_COUNT][SLRDATA_STAT_BUCKETS];
+	// page faults of the process when the statistics were enabled
+	long minor_faults;
+	long major_faults;
+};
 
 struct slrdata_t
 {
 	int fd;
 	unsigned char *ptr;
 	uint_fast64_t size;
+	uint_fast64_t capacity;
 	bool readonly;
+	// SLRDATA_HINT_ flags applied to the mapping
+	unsigned hints;
+	// NULL unless statistics are enabled
+	struct slrdata_stats_t *stats;
 	const char *restrict foldername;
 	const char *restrict filename;
+
+	// parsed from the header by slrdata_open and kept up to date by the
+	// functions changing the file
+	bool is_relation;
+	uint_fast64_t version;
+	// bytes per tuple element and incidence
+	uint_fast8_t width;
+	// tuples stored column by column, column_stride fields apart (0 for rows)
+	bool columnar;
+	uint_fast64_t column_stride;
+	uint_fast64_t arity;
+	uint_fast64_t tuple_count;
+	uint_fast64_t element_count;
+	unsigned char *tuple_list;
+	unsigned char *element_list;
+	const unsigned char *degree_table;
+	const unsigned char *hash_index;
+	bool sorted;
+	// incidence lists are delta encoded in blocks
+	bool compressed;
+	// tuples added since the incidence lists were built, with their own sorted
+	// (element, tuple) pairs
+	const unsigned char *delta;
+	uint_fast64_t delta_count;
+	// other element of every incidence of a binary relation
+	const unsigned char *neighbors;
+	// element labels: heap offset per element, the heap of labels and the
+	// hash index from label to element
+	const unsigned char *label_offsets;
+	const unsigned char *label_heap;
+	const unsigned char *label_index;
+
+	// state of the random number generator used for sampling. It is the only
+	// field queries change: a handle opened read only can be shared by threads
+	// if they sample with their own state through the _r functions.
+	uint64_t rng[4];
 };
 
 typedef struct slrdata_t slrdata_t;
 
+// entry of the catalog of relations kept in the element file
+struct slrdata_relation_info
+{
+	const char *name;
+	uint_fast64_t arity;
+	uint_fast64_t tuple_count;
+	// file size when the entry was written
+	uint_fast64_t size;
+};
+
+// the element file and all relations of its catalog, in catalog order
+struct slrdata_database_t
+{
+	slrdata_t elements;
+	uint_fast64_t relation_count;
+	slrdata_t *relations;
+	char *names;
+};
+
+typedef struct slrdata_database_t slrdata_database_t;
+
+struct slrdata_builder_t
+{
+	slrdata_t *relation;
+	uint_fast64_t arity;
+	uint_fast64_t tuple_list_offset;
+	uint_fast64_t tuple_count;
+	// tuples the columns of a columnar tuple list have room for
+	uint_fast64_t capacity;
+};
+
+typedef struct slrdata_builder_t slrdata_builder_t;
+
+struct slrdata_cursor_t
+{
+	const unsigned char *tuple_list;
+	const unsigned char *position;
+	const unsigned char *end;
+	uint_fast8_t width;
+	uint_fast64_t column_stride;
+	uint_fast64_t arity;
+	uint_fast64_t next;
+	uint_fast64_t count;
+	uint_fast64_t index;
+
+	// block of a compressed incidence list being read: its packed deltas, the
+	// deltas left in it and the last tuple index
+	bool compressed;
+	const unsigned char *packed;
+	uint_fast64_t packed_size;
+	uint_fast8_t bits;
+	uint_fast64_t left;
+	uint_fast64_t value;
+
+	// tuples or incidences of the delta segment read after the base ones
+	const unsigned char *delta_tuples;
+	const unsigned char *delta_incidences;
+	uint_fast64_t delta_first;
+	uint_fast64_t delta_next;
+	uint_fast64_t delta_count;
+};
+
+typedef struct slrdata_cursor_t slrdata_cursor_t;
+
+struct slrdata_import_options
+{
+	// arity of the tuples, 0 takes it from the first line of text input
+	uint_fast64_t arity;
+	// field delimiter of text input, 0 for spaces and tabs
+	char delimiter;
+	// little endian 64 bit element ids instead of text
+	bool binary;
+	// fields are labels, numbered in order of first appearance
+	bool labels;
+	// memory in bytes for sorting incidences before spilling runs to disk
+	size_t memory;
+	// largest number of incidences of an element, 0 for no bound
+	uint_fast64_t max_degree;
+};
+
 int slrdata_open(slrdata_t *d, const char *restrict foldername, const char *restrict filename, bool readonly, bool is_relation);
 
+int slrdata_open_hinted(slrdata_t *d, const char *restrict foldername, const char *restrict filename, bool readonly, bool is_relation, unsigned hints);
+
+int slrdata_advise(slrdata_t *d, unsigned hints);
+
+uint_fast64_t slrdata_warm_up(slrdata_t *d);
+
 void slrdata_close(slrdata_t *d);
 
+int slrdata_open_database(slrdata_database_t *db, const char *restrict foldername, bool readonly, unsigned hints);
+
+slrdata_t * slrdata_database_relation(slrdata_database_t *db, const char *name);
+
+void slrdata_close_database(slrdata_database_t *db);
+
+int slrdata_stats_enable(slrdata_t *d);
+
+int slrdata_stats_dump(slrdata_t *d, FILE *out);
+
 uint_fast64_t slrdata_arity(slrdata_t *relation);
 
 uint_fast64_t slrdata_degree(slrdata_t *relation, uint_fast64_t e);
 
 uint_fast64_t * slrdata_tuple(slrdata_t *relation, uint_fast64_t e, uint_fast64_t i);
 
+int slrdata_read_tuple(slrdata_t *relation, uint_fast64_t e, uint_fast64_t i, uint_fast64_t *tuple);
+
 uint_fast64_t slrdata_element_count(slrdata_t *d);
 
 uint_fast64_t slrdata_relation_count(slrdata_t *d);
 
+int slrdata_relation_info(slrdata_t *d, uint_fast64_t i, struct slrdata_relation_info *info);
+
+int slrdata_add_relation(slrdata_t *elements, slrdata_t *relation);
+
 uint_fast64_t slrdata_tuple_count(slrdata_t *relation);
 
 uint_fast64_t * slrdata_ith_tuple(slrdata_t *relation, uint_fast64_t i);
 
+int slrdata_read_ith_tuple(slrdata_t *relation, uint_fast64_t i, uint_fast64_t *tuple);
+
+int slrdata_read_tuples(slrdata_t *relation, const uint_fast64_t *elements, const uint_fast64_t *indices, uint_fast64_t count, uint_fast64_t *tuples);
+
+int slrdata_read_ith_tuples(slrdata_t *relation, const uint_fast64_t *indices, uint_fast64_t count, uint_fast64_t *tuples);
+
+void slrdata_degrees(slrdata_t *relation, const uint_fast64_t *elements, uint_fast64_t count, uint_fast64_t *degrees);
+
+void slrdata_tuple_cursor(slrdata_t *relation, slrdata_cursor_t *c);
+
+void slrdata_incidence_cursor(slrdata_t *relation, uint_fast64_t e, slrdata_cursor_t *c);
+
+bool slrdata_cursor_next(slrdata_cursor_t *c, uint_fast64_t *tuple);
+
+uint_fast64_t slrdata_scan_tuples(slrdata_t *relation, uint_fast64_t first, uint_fast64_t count, uint64_t *tuples);
+
+uint_fast64_t slrdata_scan_incidences(slrdata_t *relation, uint_fast64_t e, uint_fast64_t first, uint_fast64_t count, uint64_t *indices);
+
+uint_fast64_t slrdata_scan_column(slrdata_t *relation, uint_fast64_t position, uint_fast64_t first, uint_fast64_t count, uint64_t *values);
+
 int slrdata_create_directory(const char *restrict foldername);
 
 int slrdata_create_element_file(slrdata_t *d, const char *restrict foldername);
 
 int slrdata_create_relation_file(slrdata_t *d, const char *restrict foldername, const char *restrict relationname);
 
+int slrdata_create_aligned_relation_file(slrdata_t *d, const char *restrict foldername, const char *restrict relationname, uint_fast64_t element_count, uint_fast64_t tuple_count);
+
+int slrdata_create_columnar_relation_file(slrdata_t *d, const char *restrict foldername, const char *restrict relationname, uint_fast64_t element_count, uint_fast64_t tuple_count);
+
 int slrdata_add_element(slrdata_t *d, const char *restrict label);
 
+int slrdata_add_elements(slrdata_t *d, const char *const *labels, uint_fast64_t count);
+
+const char * slrdata_element_label(slrdata_t *d, uint_fast64_t id);
+
+uint_fast64_t slrdata_find_element(slrdata_t *d, const char *label, size_t length);
+
 int slrdata_add_tuple(slrdata_t *d, uint_fast64_t * tuple, uint_fast64_t arity);
 
+int slrdata_add_tuples(slrdata_t *d, const uint_fast64_t *tuples, uint_fast64_t count, uint_fast64_t arity);
+
+int slrdata_builder_init(slrdata_builder_t *b, slrdata_t *relation, uint_fast64_t arity);
+
+int slrdata_builder_add(slrdata_builder_t *b, const uint_fast64_t *tuple);
+
+int slrdata_builder_finish(slrdata_builder_t *b);
+
 int slrdata_add_incidence_lists(slrdata_t *relation, slrdata_t *elements, uint_fast64_t norm_degree, uint_fast64_t max_degree);
 
+int slrdata_build_incidence_lists(slrdata_t *relation, slrdata_t *elements, uint_fast64_t max_degree);
+
+int slrdata_build_incidence_lists_parallel(slrdata_t *relation, slrdata_t *elements, uint_fast64_t max_degree, unsigned threads);
+
+int slrdata_import(FILE *in, const char *restrict foldername, const char *restrict relationname, const struct slrdata_import_options *options);
+
 int slrdata_reduce_size(slrdata_t *rel);
 
+int slrdata_compress_incidence_lists(slrdata_t *rel);
+
+int slrdata_add_delta_tuples(slrdata_t *relation, const uint_fast64_t *tuples, uint_fast64_t count, uint_fast64_t arity);
+
+int slrdata_merge_delta(slrdata_t *relation, slrdata_t *elements, uint_fast64_t max_degree);
+
+void slrdata_seed(slrdata_t *d, uint64_t seed);
+
+void slrdata_seed_r(uint64_t *rng, uint64_t seed);
+
+uint_fast64_t slrdata_sample_element(slrdata_t *d);
+
+void slrdata_sample_elements(slrdata_t *d, uint_fast64_t *elements, uint_fast64_t k);
+
+void slrdata_sample_elements_r(slrdata_t *d, uint64_t *rng, uint_fast64_t *elements, uint_fast64_t k);
+
+uint_fast64_t slrdata_sample_tuple(slrdata_t *relation, uint_fast64_t *tuple);
+
+int slrdata_sample_tuples(slrdata_t *relation, uint_fast64_t *tuples, uint_fast64_t k);
+
+int slrdata_sample_tuples_r(slrdata_t *relation, uint64_t *rng, uint_fast64_t *tuples, uint_fast64_t k);
+
+uint_fast64_t slrdata_sample_incidence(slrdata_t *relation, uint_fast64_t e, uint_fast64_t *tuple);
+
+int slrdata_sample_incidences(slrdata_t *relation, uint_fast64_t e, uint_fast64_t *tuples, uint_fast64_t k);
+
+int slrdata_sample_incidences_r(slrdata_t *relation, uint64_t *rng, uint_fast64_t e, uint_fast64_t *tuples, uint_fast64_t k);
+
+int slrdata_add_degree_table(slrdata_t *relation);
+
+uint_fast64_t slrdata_sample_element_by_degree(slrdata_t *relation);
+
+int slrdata_sample_elements_by_degree(slrdata_t *relation, uint_fast64_t *elements, uint_fast64_t k);
+
+int slrdata_sample_elements_by_degree_r(slrdata_t *relation, uint64_t *rng, uint_fast64_t *elements, uint_fast64_t k);
+
+int slrdata_parallel_read_tuples(slrdata_t *relation, const uint_fast64_t *elements, const uint_fast64_t *indices, uint_fast64_t count, uint_fast64_t *tuples, unsigned threads);
+
+int slrdata_parallel_read_ith_tuples(slrdata_t *relation, const uint_fast64_t *indices, uint_fast64_t count, uint_fast64_t *tuples, unsigned threads);
+
+int slrdata_parallel_sample_tuples(slrdata_t *relation, uint64_t seed, uint_fast64_t *tuples, uint_fast64_t k, unsigned threads);
+
+int slrdata_parallel_sample_incidences(slrdata_t *relation, uint64_t seed, const uint_fast64_t *elements, uint_fast64_t count, uint_fast64_t *tuples, unsigned threads);
+
+int slrdata_sort_incidence_lists(slrdata_t *relation);
+
+int slrdata_add_hash_index(slrdata_t *relation);
+
+uint_fast64_t slrdata_find_tuple(slrdata_t *relation, const uint_fast64_t *tuple);
+
+bool slrdata_has_tuple(slrdata_t *relation, const uint_fast64_t *tuple);
+
+bool slrdata_adjacent(slrdata_t *relation, uint_fast64_t u, uint_fast64_t v);
+
+int slrdata_add_neighbor_table(slrdata_t *relation, uint_fast64_t slots);
+
+uint_fast64_t slrdata_neighbor(slrdata_t *relation, uint_fast64_t v, uint_fast64_t j);
+
+uint_fast64_t slrdata_scan_neighbors(slrdata_t *relation, uint_fast64_t v, uint_fast64_t first, uint_fast64_t count, uint64_t *neighbors);
@@ -6,20 +6,144 @@
 #include <sys/mman.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <endian.h>
+#include <time.h>
+#include <sys/resource.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SLRDATA_X86
+#endif
+
+#define SLRDATA_VERSION 2
+#define SLRDATA_RELATION_VERSION 3
 
 #define SLRDATA_HEADERSIZE_BASIC (3 * 8)
-#define SLRDATA_MAIN_HEADERSIZE (SLRDATA_HEADERSIZE_BASIC + 8)
+// version 1 element files only have the element list offset, version 2 adds
+// the relation list offset and the section list offset
+#define SLRDATA_MAIN_HEADERSIZE_V1 (SLRDATA_HEADERSIZE_BASIC + 8)
+#define SLRDATA_MAIN_HEADERSIZE (SLRDATA_HEADERSIZE_BASIC + (3 * 8))
 #define SLRDATA_MAIN_LISTHEADERSIZE 12
 #define SLRDATA_MAIN_ELEMENTSIZE 6
-#define SLRDATA_MAIN_RELATIONSIZE 6
+// an entry of the relation list of the element file, the catalog of the
+// relations of the folder, is the offset of the name, the arity, the tuple
+// count and the file size. The entries are followed by an open addressing
+// table from names to entries and the names.
+#define SLRDATA_MAIN_RELATIONSIZE (4 * 8)
+#define SLRDATA_MAIN_CATALOGHEADERSIZE (SLRDATA_MAIN_LISTHEADERSIZE + 8)
 
 #define SLRDATA_RELATION_HEADERSIZE_BASIC (4 * 8)
-#define SLRDATA_RELATION_HEADERSIZE (SLRDATA_RELATION_HEADERSIZE_BASIC + (2 * 8) + 6)
+// version 1 relation files have no section list offset after the arity
+#define SLRDATA_RELATION_HEADERSIZE_V1 (SLRDATA_RELATION_HEADERSIZE_BASIC + (2 * 8) + 6)
+#define SLRDATA_RELATION_HEADERSIZE_V2 (SLRDATA_RELATION_HEADERSIZE_V1 + 8)
+// version 3 relation files record the field width and the layout flags after
+// the section list offset
+#define SLRDATA_RELATION_HEADERSIZE (SLRDATA_RELATION_HEADERSIZE_V2 + 2)
+#define SLRDATA_LAYOUT_COLUMNAR 1
 #define SLRDATA_RELATION_LISTHEADERSIZE 12
 #define SLRDATA_RELATION_ELEMENTSIZE 8
-// size of tuple is SLRDATA_RELATION_TUPLEELEMENTSIZE * arity
+// size of tuple is SLRDATA_RELATION_TUPLEELEMENTSIZE * arity. Versions 1 and 2
+// pack tuple elements and incidences into 6 bytes, version 3 files use 4 or 8
+// byte fields and align the body of every list to 8 bytes.
 #define SLRDATA_RELATION_TUPLEELEMENTSIZE 6
 #define SLRDATA_RELATION_INCIDENCESIZE 6
+#define SLRDATA_ALIGNMENT 8
+
+// a section list entry is a tag, an offset and a size
+#define SLRDATA_SECTIONTAGSIZE 8
+#define SLRDATA_SECTIONENTRYSIZE (SLRDATA_SECTIONTAGSIZE + (2 * 8))
+
+// incidence list orders recorded in the "incorder" section
+#define SLRDATA_ORDER_INDEX 0
+#define SLRDATA_ORDER_TUPLE 1
+
+// incidence list encodings recorded in the "inccodec" section. Compressed
+// incidence lists are split into blocks of SLRDATA_CODEC_BLOCK tuple indices,
+// and start with a skip index entry (first index, block offset) for every
+// block after the first.
+#define SLRDATA_CODEC_PLAIN 0
+#define SLRDATA_CODEC_DELTA 1
+#define SLRDATA_CODEC_BLOCK 128
+#define SLRDATA_CODEC_SKIPENTRYSIZE 12
+
+// number of fields decoded at a time by the scans over the tuple list
+#define SLRDATA_SCAN_BLOCK 1024
+
+// requests of a batched query whose cache misses are overlapped
+#define SLRDATA_PREFETCH_GROUP 16
+
+// below this many incidences the parallel build uses the serial one
+#define SLRDATA_PARALLEL_MIN_INCIDENCES (1 << 20)
+
+// requests per chunk of a parallel query, and uint64_t between the ranges of
+// two workers so that they are on different cache lines
+#define SLRDATA_POOL_CHUNK 1024
+#define SLRDATA_POOL_STRIDE 8
+
+// sorted runs of slrdata_import merged at a time; more runs are merged in
+// several passes
+#define SLRDATA_IMPORT_FANIN 64
+
+// smallest read buffer of a run in the merge of slrdata_import, in pairs
+#define SLRDATA_IMPORT_MIN_BUFFER 256
+
+// smallest capacity a file is grown to when appending
+#define SLRDATA_MIN_CAPACITY 4096
+
+// one in this many queries of a kind is timed for the latency histograms
+#define SLRDATA_STATS_SAMPLE 64
+
+#ifdef SLRDATA_STATS
+struct slrdata_stats_timer
+{
+	struct slrdata_stats_t *stats;
+	unsigned query;
+	uint64_t start;
+};
+
+static inline uint64_t slrdata_stats_now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+// count n requests of the query and time one call in SLRDATA_STATS_SAMPLE
+static inline struct slrdata_stats_timer slrdata_stats_start(slrdata_t *d, unsigned query, uint_fast64_t n)
+{
+	struct slrdata_stats_timer t = { d->stats, query, 0 };
+	if (t.stats == NULL)
+		return t;
+
+	uint64_t calls = __atomic_fetch_add(&t.stats->calls[query], 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&t.stats->queries[query], n, __ATOMIC_RELAXED);
+	if (calls % SLRDATA_STATS_SAMPLE == 0)
+		t.start = slrdata_stats_now();
+
+	return t;
+}
+
+static inline void slrdata_stats_stop(struct slrdata_stats_timer *t)
+{
+	if (t->start == 0)
+		return;
+
+	uint64_t ns = slrdata_stats_now() - t->start;
+	unsigned bucket = ns ? 64 - __builtin_clzll(ns) : 0;
+	if (bucket >= SLRDATA_STAT_BUCKETS)
+		bucket = SLRDATA_STAT_BUCKETS - 1;
+	__atomic_fetch_add(&t->stats->latency[t->query][bucket], 1, __ATOMIC_RELAXED);
+}
+
+// Count and time the query of the function it opens, up to every return
+#define SLRDATA_STATS_QUERY(d, query, n) \
+	struct slrdata_stats_timer slrdata_stats_timer __attribute__((cleanup(slrdata_stats_stop))) = slrdata_stats_start((d), (query), (n))
+#define SLRDATA_STATS_ADD(d, field, n) \
+	do { if ((d)->stats) __atomic_fetch_add(&(d)->stats->field, (n), __ATOMIC_RELAXED); } while (0)
+#else
+#define SLRDATA_STATS_QUERY(d, query, n) do { } while (0)
+#define SLRDATA_STATS_ADD(d, field, n) do { } while (0)
+#endif
 
 static void slrdata_write(uint_fast8_t bytes, unsigned char *ptr, uint_fast64_t v)
 {
@@ -29,7 +153,7 @@ static void slrdata_write(uint_fast8_t bytes, unsigned char *ptr, uint_fast64_t
 
 static uint_fast64_t slrdata_read(uint_fast8_t bytes, const unsigned char *ptr)
 {
-	uint_fast32_t ret = 0;
+	uint_fast64_t ret = 0;
 
 	for(uint_fast8_t i = 0; i < bytes; i++)
 		ret |= ((uint_fast64_t)(ptr[i]) << i * 8);
@@ -37,6 +161,308 @@ static uint_fast64_t slrdata_read(uint_fast8_t bytes, const unsigned char *ptr)
 	return(ret);
 }
 
+static void slrdata_decode48_scalar(const unsigned char *src, uint64_t *dst, uint_fast64_t n)
+{
+	for (uint_fast64_t i = 0; i < n; i++, src += 6)
+		dst[i] = slrdata_read(6, src);
+}
+
+#ifdef SLRDATA_X86
+// Each 6 byte field goes to the low bytes of a 64 bit lane, the top two bytes
+// are zeroed (shuffle index with the high bit set).
+#define SLRDATA_DECODE48_SHUFFLE 0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11, -1, -1
+
+__attribute__((target("ssse3")))
+static void slrdata_decode48_ssse3(const unsigned char *src, uint64_t *dst, uint_fast64_t n)
+{
+	const __m128i shuffle = _mm_setr_epi8(SLRDATA_DECODE48_SHUFFLE);
+	uint_fast64_t i = 0;
+
+	// a 16 byte load covers two fields, stop while the load stays in bounds
+	for (; i + 3 <= n; i += 2)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + i * 6));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_shuffle_epi8(v, shuffle));
+	}
+
+	slrdata_decode48_scalar(src + i * 6, dst + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void slrdata_decode48_avx2(const unsigned char *src, uint64_t *dst, uint_fast64_t n)
+{
+	const __m256i shuffle = _mm256_setr_epi8(SLRDATA_DECODE48_SHUFFLE, SLRDATA_DECODE48_SHUFFLE);
+	uint_fast64_t i = 0;
+
+	// two 16 byte loads 12 bytes apart cover four fields, one per 64 bit lane
+	for (; i + 5 <= n; i += 4)
+	{
+		__m128i lo = _mm_loadu_si128((const __m128i *)(src + i * 6));
+		__m128i hi = _mm_loadu_si128((const __m128i *)(src + i * 6 + 12));
+		__m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_shuffle_epi8(v, shuffle));
+	}
+
+	slrdata_decode48_scalar(src + i * 6, dst + i, n - i);
+}
+#endif
+
+// Decode n consecutive 6 byte fields, with the widest instructions the CPU has
+static void slrdata_decode48(const unsigned char *src, uint64_t *dst, uint_fast64_t n)
+{
+#ifdef SLRDATA_X86
+	if (__builtin_cpu_supports("avx2"))
+		slrdata_decode48_avx2(src, dst, n);
+	else if (__builtin_cpu_supports("ssse3"))
+		slrdata_decode48_ssse3(src, dst, n);
+	else
+#endif
+		slrdata_decode48_scalar(src, dst, n);
+}
+
+// Field i of an array of width byte fields. 6 byte fields are packed, 4 and 8
+// byte fields are naturally aligned and read with a single load.
+static inline uint_fast64_t slrdata_get(uint_fast8_t width, const unsigned char *ptr, uint_fast64_t i)
+{
+	switch (width)
+	{
+	case 4:
+	{
+		uint32_t v;
+		memcpy(&v, __builtin_assume_aligned(ptr + i * 4, 4), 4);
+		return le32toh(v);
+	}
+	case 8:
+	{
+		uint64_t v;
+		memcpy(&v, __builtin_assume_aligned(ptr + i * 8, 8), 8);
+		return le64toh(v);
+	}
+	default:
+		return slrdata_read(6, ptr + i * 6);
+	}
+}
+
+static inline void slrdata_set(uint_fast8_t width, unsigned char *ptr, uint_fast64_t i, uint_fast64_t v)
+{
+	switch (width)
+	{
+	case 4:
+	{
+		uint32_t le = htole32(v);
+		memcpy(__builtin_assume_aligned(ptr + i * 4, 4), &le, 4);
+		break;
+	}
+	case 8:
+	{
+		uint64_t le = htole64(v);
+		memcpy(__builtin_assume_aligned(ptr + i * 8, 8), &le, 8);
+		break;
+	}
+	default:
+		slrdata_write(6, ptr + i * 6, v);
+	}
+}
+
+// whether v can be stored in a field of width bytes
+static inline bool slrdata_fits(uint_fast8_t width, uint_fast64_t v)
+{
+	return width == 8 || (v >> (width * 8)) == 0;
+}
+
+// Decode n consecutive fields of width bytes
+static void slrdata_decode(uint_fast8_t width, const unsigned char *src, uint64_t *dst, uint_fast64_t n)
+{
+	switch (width)
+	{
+	case 4:
+		for (uint_fast64_t i = 0; i < n; i++)
+			dst[i] = slrdata_get(4, src, i);
+		break;
+	case 8:
+		for (uint_fast64_t i = 0; i < n; i++)
+			dst[i] = slrdata_get(8, src, i);
+		break;
+	default:
+		slrdata_decode48(src, dst, n);
+	}
+}
+
+// Tuple decoders specialized per field width, with the loads of binary and
+// ternary tuples unrolled
+#define SLRDATA_DECODE_TUPLE(width) \
+static void slrdata_decode_tuple_##width(const unsigned char *ptr, uint_fast64_t arity, uint_fast64_t *tuple) \
+{ \
+	switch (arity) \
+	{ \
+	case 2: \
+		tuple[0] = slrdata_get(width, ptr, 0); \
+		tuple[1] = slrdata_get(width, ptr, 1); \
+		break; \
+	case 3: \
+		tuple[0] = slrdata_get(width, ptr, 0); \
+		tuple[1] = slrdata_get(width, ptr, 1); \
+		tuple[2] = slrdata_get(width, ptr, 2); \
+		break; \
+	default: \
+		for (uint_fast64_t j = 0; j < arity; j++) \
+			tuple[j] = slrdata_get(width, ptr, j); \
+	} \
+}
+
+SLRDATA_DECODE_TUPLE(4)
+SLRDATA_DECODE_TUPLE(6)
+SLRDATA_DECODE_TUPLE(8)
+
+// Decode the tuple with index i of the tuple list, stored row by row if
+// column_stride is 0 and column by column otherwise
+static inline void slrdata_decode_tuple(uint_fast8_t width, const unsigned char *tuple_list, uint_fast64_t arity, uint_fast64_t column_stride, uint_fast64_t i, uint_fast64_t *tuple)
+{
+	const unsigned char *ptr = tuple_list + i * (arity * width);
+
+	if (column_stride)
+	{
+		for (uint_fast64_t j = 0; j < arity; j++)
+			tuple[j] = slrdata_get(width, tuple_list, j * column_stride + i);
+		return;
+	}
+
+	switch (width)
+	{
+	case 4:
+		slrdata_decode_tuple_4(ptr, arity, tuple);
+		break;
+	case 8:
+		slrdata_decode_tuple_8(ptr, arity, tuple);
+		break;
+	default:
+		slrdata_decode_tuple_6(ptr, arity, tuple);
+	}
+}
+
+// Decode n tuples starting at tuple first into block, arity values per tuple
+static void slrdata_decode_tuples(uint_fast8_t width, const unsigned char *tuple_list, uint_fast64_t arity, uint_fast64_t column_stride, uint_fast64_t first, uint_fast64_t n, uint64_t *block)
+{
+	if (column_stride == 0)
+	{
+		slrdata_decode(width, tuple_list + first * (arity * width), block, n * arity);
+		return;
+	}
+
+	for (uint_fast64_t j = 0; j < arity; j++)
+		for (uint_fast64_t i = 0; i < n; i++)
+			block[i * arity + j] = slrdata_get(width, tuple_list, j * column_stride + first + i);
+}
+
+// Write v as a varint of 7 bits per byte to ptr, or only measure it if ptr is
+// NULL. Returns the number of bytes.
+static uint_fast64_t slrdata_varint_write(unsigned char *ptr, uint_fast64_t v)
+{
+	uint_fast64_t n = 0;
+
+	do
+	{
+		if (ptr)
+			ptr[n] = (v & 0x7f) | (v > 0x7f ? 0x80 : 0);
+		n++;
+		v >>= 7;
+	} while (v);
+
+	return n;
+}
+
+static uint_fast64_t slrdata_varint_read(const unsigned char *ptr, uint_fast64_t *v)
+{
+	uint_fast64_t n = 0;
+
+	*v = 0;
+	do
+	{
+		*v |= (uint_fast64_t)(ptr[n] & 0x7f) << (7 * n);
+	} while (ptr[n++] & 0x80);
+
+	return n;
+}
+
+// bytes taken by n values packed into bits bits each
+static inline uint_fast64_t slrdata_packed_size(uint_fast64_t n, uint_fast8_t bits)
+{
+	return (n * bits + 7) / 8;
+}
+
+// Value j of the values packed into bits bits each in the size bytes at
+// packed. Values are at most 48 bits wide, so one 8 byte load holds any of
+// them; only the last bytes of the packed values are loaded one by one.
+static inline uint_fast64_t slrdata_unpack(const unsigned char *packed, uint_fast64_t size, uint_fast8_t bits, uint_fast64_t j)
+{
+	uint_fast64_t bit = j * bits;
+	uint64_t word = 0;
+
+	if ((bit >> 3) + 8 <= size)
+		memcpy(&word, packed + (bit >> 3), 8);
+	else
+		memcpy(&word, packed + (bit >> 3), size - (bit >> 3));
+
+	return (le64toh(word) >> (bit & 7)) & (((uint64_t)1 << bits) - 1);
+}
+
+// Encode n non-decreasing tuple indices as a block at dst, or only measure it
+// if dst is NULL. A block is the number of bits per delta, the first index as a
+// varint and the deltas to the following indices packed into that many bits.
+// Returns the size of the block in bytes.
+static uint_fast64_t slrdata_encode_block(unsigned char *dst, const uint64_t *indices, uint_fast64_t n)
+{
+	uint64_t deltas = 0;
+	for (uint_fast64_t j = 1; j < n; j++)
+		deltas |= indices[j] - indices[j - 1];
+
+	uint_fast8_t bits = deltas ? 64 - __builtin_clzll(deltas) : 0;
+	uint_fast64_t packed_size = slrdata_packed_size(n - 1, bits);
+	uint_fast64_t size = 1 + slrdata_varint_write(NULL, indices[0]) + packed_size;
+	if (dst == NULL)
+		return size;
+
+	dst[0] = bits;
+	unsigned char *packed = dst + 1 + slrdata_varint_write(dst + 1, indices[0]);
+	memset(packed, 0, packed_size);
+
+	for (uint_fast64_t j = 1; j < n; j++)
+	{
+		uint_fast64_t bit = (j - 1) * bits;
+		uint64_t v = (indices[j] - indices[j - 1]) << (bit & 7);
+
+		for (unsigned char *p = packed + (bit >> 3); v; p++, v >>= 8)
+			*p |= v & 0xff;
+	}
+
+	return size;
+}
+
+// Decode the block of n tuple indices at src into dst. Returns the size of the
+// block in bytes.
+static uint_fast64_t slrdata_decode_block(const unsigned char *src, uint_fast64_t n, uint64_t *dst)
+{
+	uint_fast8_t bits = src[0];
+	uint_fast64_t v;
+	const unsigned char *packed = src + 1 + slrdata_varint_read(src + 1, &v);
+	uint_fast64_t packed_size = slrdata_packed_size(n - 1, bits);
+
+	dst[0] = v;
+	for (uint_fast64_t j = 1; j < n; j++)
+		dst[j] = v += slrdata_unpack(packed, packed_size, bits, j - 1);
+
+	return packed + packed_size - src;
+}
+
+// Position j of the tuple with index i
+static inline uint_fast64_t slrdata_tuple_field(slrdata_t *relation, uint_fast64_t i, uint_fast64_t j)
+{
+	if (relation->column_stride)
+		return slrdata_get(relation->width, relation->tuple_list, j * relation->column_stride + i);
+
+	return slrdata_get(relation->width, relation->tuple_list, i * relation->arity + j);
+}
+
 static bool slrdata_is_relation_file(slrdata_t *d)
 {
 	if(strncmp(d->ptr + 7, "relation", 8))
@@ -47,8 +473,153 @@ static bool slrdata_is_relation_file(slrdata_t *d)
 	return true;
 }
 
+// offset of the section list offset in the header, 0 if the file has none
+static uint_fast64_t slrdata_section_list_field(slrdata_t *d)
+{
+	if (d->is_relation && d->version >= 2)
+		return SLRDATA_RELATION_HEADERSIZE_V1;
+	if (!d->is_relation && d->version >= 2)
+		return SLRDATA_MAIN_HEADERSIZE_V1 + 8;
+
+	return 0;
+}
+
+// size of the header of an element file of the version of d
+static uint_fast64_t slrdata_main_headersize(slrdata_t *d)
+{
+	return d->version == 1 ? SLRDATA_MAIN_HEADERSIZE_V1 : SLRDATA_MAIN_HEADERSIZE;
+}
+
+// size of the header of a relation file of the version of d
+static uint_fast64_t slrdata_relation_headersize(slrdata_t *d)
+{
+	if (d->version == 1)
+		return SLRDATA_RELATION_HEADERSIZE_V1;
+	if (d->version == 2)
+		return SLRDATA_RELATION_HEADERSIZE_V2;
+
+	return SLRDATA_RELATION_HEADERSIZE;
+}
+
+// First offset at or after offset where a list can start. Lists of packed files
+// follow each other directly, in files with 4 or 8 byte fields the list body
+// after the 12 byte header is aligned.
+static uint_fast64_t slrdata_list_align(uint_fast8_t width, uint_fast64_t offset)
+{
+	if (width == SLRDATA_RELATION_TUPLEELEMENTSIZE)
+		return offset;
+
+	uint_fast64_t body = (offset + SLRDATA_RELATION_LISTHEADERSIZE + SLRDATA_ALIGNMENT - 1) & ~(uint_fast64_t)(SLRDATA_ALIGNMENT - 1);
+	return body - SLRDATA_RELATION_LISTHEADERSIZE;
+}
+
+// Bytes from the start of an aligned list with a body of size bytes to the
+// start of the next one
+static uint_fast64_t slrdata_list_stride(uint_fast8_t width, uint_fast64_t size)
+{
+	if (width == SLRDATA_RELATION_TUPLEELEMENTSIZE)
+		return SLRDATA_RELATION_LISTHEADERSIZE + size;
+
+	return (SLRDATA_RELATION_LISTHEADERSIZE + size + SLRDATA_ALIGNMENT - 1) & ~(uint_fast64_t)(SLRDATA_ALIGNMENT - 1);
+}
+
+// Look up the section with the given tag. Returns NULL if there is none.
+static unsigned char * slrdata_section(slrdata_t *d, const char *tag, uint_fast64_t *size)
+{
+	uint_fast64_t field = slrdata_section_list_field(d);
+	if (field == 0 || field + 8 > d->size)
+		return NULL;
+
+	uint_fast64_t section_list_offset = slrdata_read(8, d->ptr + field);
+	if (section_list_offset == 0)
+		return NULL;
+
+	uint_fast64_t count = slrdata_read(6, d->ptr + section_list_offset + 6);
+	const unsigned char *entry = d->ptr + section_list_offset + SLRDATA_RELATION_LISTHEADERSIZE;
+	for (uint_fast64_t i = 0; i < count; i++, entry += SLRDATA_SECTIONENTRYSIZE)
+	{
+		if (strncmp((const char *)entry, tag, SLRDATA_SECTIONTAGSIZE) == 0)
+		{
+			if (size)
+				*size = slrdata_read(8, entry + SLRDATA_SECTIONTAGSIZE + 8);
+
+			return d->ptr + slrdata_read(8, entry + SLRDATA_SECTIONTAGSIZE);
+		}
+	}
+
+	return NULL;
+}
+
+// Parse the header into the cached fields of d. Must be called whenever the
+// file is remapped or one of the list headers changes.
+static void slrdata_refresh(slrdata_t *d)
+{
+	d->is_relation = slrdata_is_relation_file(d);
+	d->version = slrdata_read(8, d->ptr + (d->is_relation ? 16 : 8));
+	d->width = SLRDATA_RELATION_TUPLEELEMENTSIZE;
+	d->columnar = false;
+	d->column_stride = 0;
+	d->arity = 0;
+	d->tuple_count = 0;
+	d->element_count = 0;
+	d->tuple_list = NULL;
+	d->element_list = NULL;
+
+	uint_fast64_t element_list_offset;
+	if (d->is_relation)
+	{
+		uint_fast64_t tuple_list_offset = slrdata_read(8, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC);
+		if (tuple_list_offset && tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE <= d->size)
+		{
+			d->tuple_list = d->ptr + tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE;
+			d->tuple_count = slrdata_read(6, d->ptr + tuple_list_offset + 6);
+		}
+
+		d->arity = slrdata_read(6, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 16);
+		if (d->version >= 3 && SLRDATA_RELATION_HEADERSIZE <= d->size)
+		{
+			d->width = slrdata_read(1, d->ptr + SLRDATA_RELATION_HEADERSIZE_V2);
+			d->columnar = slrdata_read(1, d->ptr + SLRDATA_RELATION_HEADERSIZE_V2 + 1) & SLRDATA_LAYOUT_COLUMNAR;
+		}
+
+		// the size of a columnar tuple list is the room reserved for its columns
+		if (d->columnar && d->tuple_list && d->arity)
+			d->column_stride = slrdata_read(6, d->tuple_list - SLRDATA_RELATION_LISTHEADERSIZE) / (d->arity * d->width);
+		element_list_offset = slrdata_read(8, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 8);
+	}
+	else
+	{
+		element_list_offset = slrdata_read(8, d->ptr + SLRDATA_HEADERSIZE_BASIC);
+	}
+
+	if (element_list_offset && element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE <= d->size)
+	{
+		d->element_list = d->ptr + element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE;
+		d->element_count = slrdata_read(6, d->ptr + element_list_offset + 6);
+	}
+
+	d->degree_table = slrdata_section(d, "degalias", NULL);
+
+	d->hash_index = slrdata_section(d, "tuplhash", NULL);
+
+	const unsigned char *order = slrdata_section(d, "incorder", NULL);
+	d->sorted = order && slrdata_read(8, order) == SLRDATA_ORDER_TUPLE;
+
+	const unsigned char *codec = slrdata_section(d, "inccodec", NULL);
+	d->compressed = codec && slrdata_read(8, codec) == SLRDATA_CODEC_DELTA;
+
+	d->delta = slrdata_section(d, "tupdelta", NULL);
+	d->delta_count = d->delta ? slrdata_read(8, d->delta) : 0;
+
+	d->neighbors = slrdata_section(d, "neighbor", NULL);
+
+	d->label_offsets = slrdata_section(d, "lbloffs", NULL);
+	d->label_heap = slrdata_section(d, "lblheap", NULL);
+	d->label_index = slrdata_section(d, "lblindex", NULL);
+}
+
 // Write a new basic header
-static void slrdata_headerinit(unsigned char *header, uint_fast64_t filesize, bool is_relation)
+static void slrdata_headerinit(unsigned char *header, uint_fast64_t filesize, bool is_relation, uint_fast64_t version)
 {
 	if (is_relation)
 	{
@@ -60,7 +631,7 @@ static void slrdata_headerinit(unsigned char *header, uint_fast64_t filesize, bo
 	}
 
 	// Version
-	slrdata_write(8, header + (is_relation ? 16 : 8), 1);
+	slrdata_write(8, header + (is_relation ? 16 : 8), version);
 
 	// Size
 	slrdata_write(8, header + (is_relation ? 16 : 8) + 8, filesize);
@@ -87,6 +658,10 @@ static int slrdata_create_and_write_file(slrdata_t *d, char* filepath, unsigned
 
 	d->readonly = false;
 	d->size = size;
+	d->capacity = size;
+	d->hints = 0;
+	d->stats = NULL;
+	slrdata_seed(d, 0);
 
 	return(0);
 }
@@ -101,465 +676,4808 @@ char* slrdata_filepath(const char *restrict foldername, const char *restrict fil
 	return filepath;
 }
 
-static int slrdata_resize(slrdata_t *d, size_t s, bool is_relation)
+// flags of mmap for the hints of d
+static inline int slrdata_map_flags(slrdata_t *d)
+{
+	return MAP_SHARED | (d->hints & SLRDATA_HINT_POPULATE ? MAP_POPULATE : 0);
+}
+
+struct slrdata_range
 {
-	munmap(d->ptr, d->size);
+	const unsigned char *ptr;
+	uint_fast64_t size;
+};
 
-	if(ftruncate(d->fd, s))
+// The parts of d read by almost every query: the header, the element list
+// with the offsets of the incidence lists, the section list and the degree
+// table, hash index and delta segment. Returns their number.
+static unsigned slrdata_hot_ranges(slrdata_t *d, struct slrdata_range *ranges)
+{
+	unsigned n = 0;
+
+	ranges[n].ptr = d->ptr;
+	ranges[n++].size = d->is_relation ? slrdata_relation_headersize(d) : slrdata_main_headersize(d);
+
+	if (d->element_list)
 	{
-		close(d->fd);
-		return(-1);
+		ranges[n].ptr = d->element_list - SLRDATA_RELATION_LISTHEADERSIZE;
+		ranges[n].size = SLRDATA_RELATION_LISTHEADERSIZE + slrdata_read(6, ranges[n].ptr);
+		n++;
 	}
 
-	d->size = s;
+	uint_fast64_t field = slrdata_section_list_field(d);
+	uint_fast64_t section_list_offset = field ? slrdata_read(8, d->ptr + field) : 0;
+	if (section_list_offset)
+	{
+		ranges[n].ptr = d->ptr + section_list_offset;
+		ranges[n].size = SLRDATA_RELATION_LISTHEADERSIZE + slrdata_read(6, ranges[n].ptr);
+		n++;
+	}
 
-	if((d->ptr = mmap(0, d->size, d->readonly ? PROT_READ : (PROT_READ | PROT_WRITE), MAP_SHARED, d->fd, 0)) == MAP_FAILED)
+	const char *tags[] = { "degalias", "tuplhash", "tupdelta" };
+	for (unsigned i = 0; i < sizeof(tags) / sizeof(tags[0]); i++)
 	{
-		close(d->fd);
-		return(-1);
+		uint_fast64_t size;
+		const unsigned char *section = slrdata_section(d, tags[i], &size);
+		if (section)
+		{
+			ranges[n].ptr = section;
+			ranges[n++].size = size;
+		}
 	}
 
-	slrdata_write(8, d->ptr + (is_relation ? SLRDATA_RELATION_HEADERSIZE_BASIC : SLRDATA_HEADERSIZE_BASIC) - 8, d->size);
+	return n;
+}
 
-	return(0);
+// madvise the pages holding size bytes at ptr in the mapping of d
+static int slrdata_advise_range(slrdata_t *d, const unsigned char *ptr, uint_fast64_t size, int advice)
+{
+	uint_fast64_t page = sysconf(_SC_PAGESIZE);
+	uint_fast64_t offset = (ptr - d->ptr) & ~(page - 1);
+
+	if (size == 0)
+		return(0);
+
+	return madvise(d->ptr + offset, ptr - d->ptr + size - offset, advice);
 }
 
-int slrdata_open(slrdata_t *d, const char *restrict foldername, const char *restrict filename, bool readonly, bool is_relation)
+// Apply the hints of d to its current mapping. Access pattern advice is best
+// effort; only a failing mlock is reported.
+static int slrdata_apply_hints(slrdata_t *d)
 {
-	struct stat stat;
+	if (d->hints == 0 || d->capacity == 0)
+		return(0);
 
-	if((d->fd = open(slrdata_filepath(foldername, filename), readonly ? O_RDONLY : O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH)) == -1)
-		return(-1);
+	if (d->hints & SLRDATA_HINT_SEQUENTIAL)
+		madvise(d->ptr, d->capacity, MADV_SEQUENTIAL);
+	else if (d->hints & SLRDATA_HINT_RANDOM)
+		madvise(d->ptr, d->capacity, MADV_RANDOM);
 
-	fstat(d->fd, &stat);
+#ifdef MADV_HUGEPAGE
+	if (d->hints & SLRDATA_HINT_HUGEPAGES)
+		madvise(d->ptr, d->capacity, MADV_HUGEPAGE);
+#endif
 
-	uint_fast64_t headersize_basic = is_relation ? SLRDATA_RELATION_HEADERSIZE_BASIC : SLRDATA_HEADERSIZE_BASIC;
-	if(stat.st_size < headersize_basic) // File is too small to be valid
-	{
-		close(d->fd);
-		return(-1);
-	}
-	else if(stat.st_size) // Check if file is valid
+	// the small tables every random query goes through are read ahead
+	// regardless, so that the first queries do not fault on them
+	struct slrdata_range ranges[6];
+	unsigned n = slrdata_hot_ranges(d, ranges);
+	for (unsigned i = 0; i < n; i++)
 	{
-		// Checks we can map
-		if((d->ptr = mmap(0, headersize_basic, PROT_READ, MAP_SHARED, d->fd, 0)) == MAP_FAILED)
-		{
-			close(d->fd);
+		if (d->hints & SLRDATA_HINT_RANDOM)
+			slrdata_advise_range(d, ranges[i].ptr, ranges[i].size, MADV_WILLNEED);
+		if ((d->hints & SLRDATA_HINT_LOCK) && mlock(ranges[i].ptr, ranges[i].size))
 			return(-1);
-		}
+	}
 
-		// We check:
-		// it starts with 'slrdata' AND
-		// it is version 1
-		if(strncmp(d->ptr, "slrdata", 7) || slrdata_read(8, d->ptr + (is_relation ? 16 : 8)) != 1
-				|| (is_relation && strncmp(d->ptr + 7, "relation", 8)))
-		{
-			close(d->fd);
-			return(-1);
-		}
+	return(0);
+}
 
-		d->size = slrdata_read(8, d->ptr + headersize_basic - 8);
+// Remap the file with exactly capacity bytes
+static int slrdata_remap(slrdata_t *d, uint_fast64_t capacity)
+{
+	munmap(d->ptr, d->capacity);
 
-		munmap(d->ptr, headersize_basic);
+	if(ftruncate(d->fd, capacity))
+	{
+		close(d->fd);
+		return(-1);
 	}
 
-	if((d->ptr = mmap(0, d->size, readonly ? PROT_READ : (PROT_READ | PROT_WRITE), MAP_SHARED, d->fd, 0)) == MAP_FAILED)
+	if((d->ptr = mmap(0, capacity, d->readonly ? PROT_READ : (PROT_READ | PROT_WRITE), slrdata_map_flags(d), d->fd, 0)) == MAP_FAILED)
 	{
 		close(d->fd);
 		return(-1);
 	}
 
-	d->foldername = foldername;
-	d->filename = filename;
+	d->capacity = capacity;
+	slrdata_refresh(d);
+	slrdata_apply_hints(d);
+	SLRDATA_STATS_ADD(d, remaps, 1);
+	SLRDATA_STATS_ADD(d, remapped_bytes, capacity);
 
 	return(0);
 }
 
-void slrdata_close(slrdata_t *d)
+// Make sure at least s bytes are mapped. The file grows geometrically so that
+// appending n items costs O(log n) remaps rather than one remap per item.
+static int slrdata_reserve(slrdata_t *d, uint_fast64_t s)
 {
-	munmap(d->ptr, d->size);
-	close(d->fd);
+	if(s <= d->capacity)
+		return(0);
+
+	uint_fast64_t capacity = d->capacity < SLRDATA_MIN_CAPACITY ? SLRDATA_MIN_CAPACITY : d->capacity;
+	while(capacity < s)
+		capacity += capacity / 2;
+
+	return slrdata_remap(d, capacity);
 }
 
-int slrdata_create_directory(const char *restrict foldername)
+// Set the used size of the file. Capacity is only ever grown here, it is given
+// back by slrdata_trim.
+static int slrdata_resize(slrdata_t *d, size_t s, bool is_relation)
 {
-	// makes directory - errors if it already exists TODO check modes
-	if(mkdir(foldername, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH))
+	if(slrdata_reserve(d, s))
 		return(-1);
 
+	SLRDATA_STATS_ADD(d, resizes, 1);
+	d->size = s;
+
+	slrdata_write(8, d->ptr + (is_relation ? SLRDATA_RELATION_HEADERSIZE_BASIC : SLRDATA_HEADERSIZE_BASIC) - 8, d->size);
+	slrdata_refresh(d);
+
 	return(0);
 }
 
-int slrdata_create_element_file(slrdata_t *d, const char *restrict foldername)
+// Truncate the file to its used size
+static int slrdata_trim(slrdata_t *d)
 {
-	uint_fast64_t size = SLRDATA_HEADERSIZE_BASIC;
-	unsigned char data[size];
+	if(d->readonly || d->capacity == d->size)
+		return(0);
 
-	slrdata_headerinit(data, size, false);
+	return slrdata_remap(d, d->size);
+}
 
-	if(slrdata_create_and_write_file(d, slrdata_filepath(foldername, "elements"), data, size))
-	{
-		return(-1);
+// Append a section of size bytes to the end of the file, replacing any
+// section with the same tag. The section list is rewritten after it. Returns
+// the offset of the (8 byte aligned) section or 0 if the file cannot have
+// sections.
+static uint_fast64_t slrdata_add_section(slrdata_t *d, const char *tag, uint_fast64_t size)
+{
+	uint_fast64_t field = slrdata_section_list_field(d);
+	if (field == 0)
+		return(0);
+
+	uint_fast64_t old_list_offset = slrdata_read(8, d->ptr + field);
+	uint_fast64_t old_count = old_list_offset ? slrdata_read(6, d->ptr + old_list_offset + 6) : 0;
+
+	uint_fast64_t section_offset = (d->size + 7) & ~(uint_fast64_t)7;
+	uint_fast64_t list_offset = (section_offset + size + 7) & ~(uint_fast64_t)7;
+
+	if (slrdata_resize(d, list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (old_count + 1) * SLRDATA_SECTIONENTRYSIZE, d->is_relation))
+		return(0);
+
+	// copy the other entries
+	unsigned char *entry = d->ptr + list_offset + SLRDATA_RELATION_LISTHEADERSIZE;
+	const unsigned char *old_entry = d->ptr + old_list_offset + SLRDATA_RELATION_LISTHEADERSIZE;
+	uint_fast64_t count = 0;
+	for (uint_fast64_t i = 0; i < old_count; i++, old_entry += SLRDATA_SECTIONENTRYSIZE)
+	{
+		if (strncmp((const char *)old_entry, tag, SLRDATA_SECTIONTAGSIZE))
+		{
+			memcpy(entry, old_entry, SLRDATA_SECTIONENTRYSIZE);
+			entry += SLRDATA_SECTIONENTRYSIZE;
+			count++;
+		}
+	}
+
+	// add the new entry
+	memset(entry, 0, SLRDATA_SECTIONTAGSIZE);
+	memcpy(entry, tag, strnlen(tag, SLRDATA_SECTIONTAGSIZE));
+	slrdata_write(8, entry + SLRDATA_SECTIONTAGSIZE, section_offset);
+	slrdata_write(8, entry + SLRDATA_SECTIONTAGSIZE + 8, size);
+	count++;
+
+	// section list header
+	slrdata_write(6, d->ptr + list_offset, count * SLRDATA_SECTIONENTRYSIZE);
+	slrdata_write(6, d->ptr + list_offset + 6, count);
+
+	if (slrdata_resize(d, list_offset + SLRDATA_RELATION_LISTHEADERSIZE + count * SLRDATA_SECTIONENTRYSIZE, d->is_relation))
+		return(0);
+
+	slrdata_write(8, d->ptr + field, list_offset);
+	slrdata_refresh(d);
+
+	return(section_offset);
+}
+
+// Grow the section with the given tag to size bytes, keeping its content. A
+// section directly before the section list at the end of the file grows in
+// place, any other one is moved to the end of the file. Returns the offset of
+// the section or 0 on failure.
+static uint_fast64_t slrdata_extend_section(slrdata_t *d, const char *tag, uint_fast64_t size)
+{
+	uint_fast64_t old_size = 0;
+	const unsigned char *old_section = slrdata_section(d, tag, &old_size);
+	if (old_section == NULL)
+		return slrdata_add_section(d, tag, size);
+
+	uint_fast64_t field = slrdata_section_list_field(d);
+	uint_fast64_t old_offset = old_section - d->ptr;
+	uint_fast64_t list_offset = slrdata_read(8, d->ptr + field);
+	uint_fast64_t count = slrdata_read(6, d->ptr + list_offset + 6);
+	uint_fast64_t list_size = SLRDATA_RELATION_LISTHEADERSIZE + count * SLRDATA_SECTIONENTRYSIZE;
+
+	if (((old_offset + old_size + 7) & ~(uint_fast64_t)7) != list_offset || list_offset + list_size != d->size)
+	{
+		uint_fast64_t offset = slrdata_add_section(d, tag, size);
+		if (offset)
+			memcpy(d->ptr + offset, d->ptr + old_offset, old_size);
+
+		return(offset);
+	}
+
+	uint_fast64_t new_list_offset = (old_offset + size + 7) & ~(uint_fast64_t)7;
+	if (slrdata_resize(d, new_list_offset + list_size, d->is_relation))
+		return(0);
+
+	memmove(d->ptr + new_list_offset, d->ptr + list_offset, list_size);
+	unsigned char *entry = d->ptr + new_list_offset + SLRDATA_RELATION_LISTHEADERSIZE;
+	for (uint_fast64_t i = 0; i < count; i++, entry += SLRDATA_SECTIONENTRYSIZE)
+	{
+		if (strncmp((const char *)entry, tag, SLRDATA_SECTIONTAGSIZE) == 0)
+			slrdata_write(8, entry + SLRDATA_SECTIONTAGSIZE + 8, size);
+	}
+
+	slrdata_write(8, d->ptr + field, new_list_offset);
+	slrdata_refresh(d);
+
+	return(old_offset);
+}
+
+int slrdata_open(slrdata_t *d, const char *restrict foldername, const char *restrict filename, bool readonly, bool is_relation)
+{
+	return slrdata_open_hinted(d, foldername, filename, readonly, is_relation, 0);
+}
+
+// Check the header of the file open as d->fd and map it for the workload
+// described by hints. The header is checked with a single read instead of a
+// mapping of its own. Closes the file on failure.
+static int slrdata_map_file(slrdata_t *d, const char *restrict foldername, const char *restrict filename, bool readonly, bool is_relation, unsigned hints)
+{
+	unsigned char header[SLRDATA_RELATION_HEADERSIZE_BASIC];
+	uint_fast64_t headersize_basic = is_relation ? SLRDATA_RELATION_HEADERSIZE_BASIC : SLRDATA_HEADERSIZE_BASIC;
+
+	// We check:
+	// the file is large enough for the header AND
+	// it starts with 'slrdata' AND
+	// it is a version we can read
+	if(pread(d->fd, header, headersize_basic, 0) != (ssize_t)headersize_basic)
+	{
+		close(d->fd);
+		return(-1);
+	}
+
+	uint_fast64_t version = slrdata_read(8, header + (is_relation ? 16 : 8));
+	if(strncmp((const char *)header, "slrdata", 7) || version < 1 || version > (is_relation ? SLRDATA_RELATION_VERSION : SLRDATA_VERSION)
+			|| (is_relation && strncmp((const char *)header + 7, "relation", 8)))
+	{
+		close(d->fd);
+		return(-1);
+	}
+
+	d->size = slrdata_read(8, header + headersize_basic - 8);
+
+	d->hints = hints;
+	d->stats = NULL;
+	if((d->ptr = mmap(0, d->size, readonly ? PROT_READ : (PROT_READ | PROT_WRITE), slrdata_map_flags(d), d->fd, 0)) == MAP_FAILED)
+	{
+		close(d->fd);
+		return(-1);
+	}
+
+	d->capacity = d->size;
+	slrdata_seed(d, 0);
+	d->readonly = readonly;
+	d->foldername = foldername;
+	d->filename = filename;
+	slrdata_refresh(d);
+
+	if(slrdata_apply_hints(d))
+	{
+		munmap(d->ptr, d->capacity);
+		close(d->fd);
+		return(-1);
+	}
+
+	return(0);
+}
+
+// Open a file and map it for the workload described by hints, a combination
+// of the SLRDATA_HINT_ flags. The hints stay with the handle and are applied
+// again whenever the file is remapped.
+int slrdata_open_hinted(slrdata_t *d, const char *restrict foldername, const char *restrict filename, bool readonly, bool is_relation, unsigned hints)
+{
+	char *path = slrdata_filepath(foldername, filename);
+	d->fd = open(path, readonly ? O_RDONLY : O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+	free(path);
+	if(d->fd == -1)
+		return(-1);
+
+	return slrdata_map_file(d, foldername, filename, readonly, is_relation, hints);
+}
+
+// Change the hints of an open file. Locked parts stay locked until the file
+// is remapped or closed.
+int slrdata_advise(slrdata_t *d, unsigned hints)
+{
+	if(d->hints & ~hints & (SLRDATA_HINT_RANDOM | SLRDATA_HINT_SEQUENTIAL))
+		madvise(d->ptr, d->capacity, MADV_NORMAL);
+
+	d->hints = hints;
+
+	return slrdata_apply_hints(d);
+}
+
+// Read the header, element list, section list, degree table, hash index and
+// delta segment into memory, so that queries right after opening a cold file
+// only fault on the incidence lists and tuples they touch. Returns the number
+// of bytes warmed up.
+uint_fast64_t slrdata_warm_up(slrdata_t *d)
+{
+	struct slrdata_range ranges[6];
+	unsigned n = slrdata_hot_ranges(d, ranges);
+	uint_fast64_t page = sysconf(_SC_PAGESIZE);
+	uint_fast64_t bytes = 0;
+	volatile unsigned char sink = 0;
+
+	for (unsigned i = 0; i < n; i++)
+	{
+		slrdata_advise_range(d, ranges[i].ptr, ranges[i].size, MADV_WILLNEED);
+
+		// touch every page, the advice alone only starts the reads
+		for (uint_fast64_t offset = 0; offset < ranges[i].size; offset += page)
+			sink += ranges[i].ptr[offset];
+		if (ranges[i].size)
+			sink += ranges[i].ptr[ranges[i].size - 1];
+
+		bytes += ranges[i].size;
+	}
+
+	return bytes;
+}
+
+// Unmap and close the file. A writable file with room reserved for growing is
+// truncated to its used size without being mapped again; read only handles
+// never change the file. The truncation is best effort: a file it fails on
+// keeps its spare room, which slrdata_open ignores as it maps only the used
+// size recorded in the header.
+void slrdata_close(slrdata_t *d)
+{
+	munmap(d->ptr, d->capacity);
+	if (!d->readonly && d->size != d->capacity)
+		ftruncate(d->fd, d->size);
+	close(d->fd);
+	free(d->stats);
+	d->stats = NULL;
+}
+
+// Start gathering statistics on the handle, or clear them. Returns -1 if the
+// library was built without SLRDATA_STATS.
+int slrdata_stats_enable(slrdata_t *d)
+{
+#ifdef SLRDATA_STATS
+	if (d->stats == NULL && (d->stats = malloc(sizeof(struct slrdata_stats_t))) == NULL)
+		return(-1);
+
+	memset(d->stats, 0, sizeof(struct slrdata_stats_t));
+
+	// page faults are counted for the process, from now on
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	d->stats->minor_faults = usage.ru_minflt;
+	d->stats->major_faults = usage.ru_majflt;
+
+	return(0);
+#else
+	return(-1);
+#endif
+}
+
+// Write the statistics of the handle to out as a JSON object. The latency
+// histogram of a query counts the timed calls taking 2^(b-1) to 2^b - 1 ns in
+// bucket b, up to the last bucket that is not empty.
+int slrdata_stats_dump(slrdata_t *d, FILE *out)
+{
+	static const char *names[SLRDATA_STAT_COUNT] = { "degree", "tuple", "ith_tuple", "sample", "lookup", "batch", "scan", "neighbor" };
+	struct slrdata_stats_t *stats = d->stats;
+	if (stats == NULL)
+		return(-1);
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	fprintf(out, "{\"mapped_bytes\": %llu, \"resizes\": %llu, \"remaps\": %llu, \"remapped_bytes\": %llu, \"minor_faults\": %ld, \"major_faults\": %ld, \"queries\": {",
+			(unsigned long long)d->capacity, (unsigned long long)stats->resizes, (unsigned long long)stats->remaps,
+			(unsigned long long)stats->remapped_bytes, usage.ru_minflt - stats->minor_faults, usage.ru_majflt - stats->major_faults);
+
+	for (unsigned q = 0; q < SLRDATA_STAT_COUNT; q++)
+	{
+		unsigned buckets = SLRDATA_STAT_BUCKETS;
+		while (buckets > 0 && stats->latency[q][buckets - 1] == 0)
+			buckets--;
+
+		fprintf(out, "%s\"%s\": {\"calls\": %llu, \"requests\": %llu, \"latency_ns_log2\": [", q ? ", " : "", names[q],
+				(unsigned long long)stats->calls[q], (unsigned long long)stats->queries[q]);
+		for (unsigned b = 0; b < buckets; b++)
+			fprintf(out, "%s%llu", b ? ", " : "", (unsigned long long)stats->latency[q][b]);
+		fprintf(out, "]}");
+	}
+	fprintf(out, "}}");
+
+	return ferror(out) ? -1 : 0;
+}
+
+int slrdata_create_directory(const char *restrict foldername)
+{
+	// makes directory - errors if it already exists TODO check modes
+	if(mkdir(foldername, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH))
+		return(-1);
+
+	return(0);
+}
+
+int slrdata_create_element_file(slrdata_t *d, const char *restrict foldername)
+{
+	uint_fast64_t size = SLRDATA_HEADERSIZE_BASIC;
+	unsigned char data[size];
+
+	slrdata_headerinit(data, size, false, SLRDATA_VERSION);
+
+	if(slrdata_create_and_write_file(d, slrdata_filepath(foldername, "elements"), data, size))
+	{
+		return(-1);
+	}
+
+	// element, relation and section list offsets
+	slrdata_resize(d, SLRDATA_MAIN_HEADERSIZE, false);
+	memset(d->ptr + SLRDATA_HEADERSIZE_BASIC, 0, SLRDATA_MAIN_HEADERSIZE - SLRDATA_HEADERSIZE_BASIC);
+	slrdata_refresh(d);
+
+	d->foldername = foldername;
+	d->filename = "elements";
+
+	return(0);
+}
+
+// Create a relation file of the given version, with fields of width bytes and
+// the given layout flags if it is version 3
+static int slrdata_create_relation(slrdata_t *d, const char *restrict foldername, const char *restrict relationname, uint_fast64_t version, uint_fast8_t width, uint_fast8_t layout)
+{
+	uint_fast64_t size = SLRDATA_RELATION_HEADERSIZE_BASIC;
+	unsigned char data[size];
+
+	slrdata_headerinit(data, size, true, version);
+
+	if(slrdata_create_and_write_file(d, slrdata_filepath(foldername, relationname), data, size))
+	{
+		return(-1);
+	}
+
+	slrdata_refresh(d);
+	slrdata_resize(d, slrdata_relation_headersize(d), true);
+
+	slrdata_write(8, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC, 0);
+	slrdata_write(8, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 8, 0);
+	// TODO arity
+	slrdata_write(6, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 16, 0);
+	if (version >= 2)
+	{
+		// section list
+		slrdata_write(8, d->ptr + SLRDATA_RELATION_HEADERSIZE_V1, 0);
+	}
+	if (version >= 3)
+	{
+		slrdata_write(1, d->ptr + SLRDATA_RELATION_HEADERSIZE_V2, width);
+		slrdata_write(1, d->ptr + SLRDATA_RELATION_HEADERSIZE_V2 + 1, layout);
+	}
+	slrdata_refresh(d);
+
+	d->foldername = foldername;
+	d->filename = relationname;
+
+	return(0);
+}
+
+int slrdata_create_relation_file(slrdata_t *d, const char *restrict foldername, const char *restrict relationname)
+{
+	return slrdata_create_relation(d, foldername, relationname, 2, SLRDATA_RELATION_TUPLEELEMENTSIZE, 0);
+}
+
+// Create a version 3 relation file for at most element_count elements and
+// tuple_count tuples. Its tuple elements and incidences are 4 byte fields if
+// both fit, 8 byte fields otherwise, and every list body is 8 byte aligned so
+// that they are read with single aligned loads.
+int slrdata_create_aligned_relation_file(slrdata_t *d, const char *restrict foldername, const char *restrict relationname, uint_fast64_t element_count, uint_fast64_t tuple_count)
+{
+	uint_fast8_t width = element_count <= ((uint_fast64_t)1 << 32) && tuple_count <= ((uint_fast64_t)1 << 32) ? 4 : 8;
+
+	return slrdata_create_relation(d, foldername, relationname, SLRDATA_RELATION_VERSION, width, 0);
+}
+
+// Like slrdata_create_aligned_relation_file, but the tuple list stores every
+// position of the tuples as its own contiguous column, so that scans of one
+// position with slrdata_scan_column read only that column. Tuples are still
+// read whole by all other functions.
+int slrdata_create_columnar_relation_file(slrdata_t *d, const char *restrict foldername, const char *restrict relationname, uint_fast64_t element_count, uint_fast64_t tuple_count)
+{
+	uint_fast8_t width = element_count <= ((uint_fast64_t)1 << 32) && tuple_count <= ((uint_fast64_t)1 << 32) ? 4 : 8;
+
+	return slrdata_create_relation(d, foldername, relationname, SLRDATA_RELATION_VERSION, width, SLRDATA_LAYOUT_COLUMNAR);
+}
+
+// start the element list if the element file does not have one yet
+static uint_fast64_t slrdata_element_list_begin(slrdata_t *d)
+{
+	uint_fast64_t element_list_offset = slrdata_read(8, d->ptr + SLRDATA_HEADERSIZE_BASIC);
+	if (element_list_offset == 0)
+	{
+		element_list_offset = d->size;
+
+		// update element list offset
+		slrdata_write(8, d->ptr + SLRDATA_HEADERSIZE_BASIC, element_list_offset);
+
+		// resize
+		if(slrdata_resize(d, element_list_offset + SLRDATA_MAIN_LISTHEADERSIZE, false))
+			return(0);
+
+		// add element list header
+		slrdata_write(6, d->ptr + element_list_offset, 0);
+		slrdata_write(6, d->ptr + element_list_offset + 6, 0);
+		slrdata_refresh(d);
+	}
+
+	return(element_list_offset);
+}
+
+// Make a version 1 element file a version 2 one, which can have sections. The
+// element list directly after the old header is moved to the end of the file
+// to make room for the new header fields.
+static int slrdata_upgrade_element_file(slrdata_t *d)
+{
+	if (d->version >= 2)
+		return(0);
+
+	uint_fast64_t old_offset = slrdata_read(8, d->ptr + SLRDATA_HEADERSIZE_BASIC);
+	uint_fast64_t list_size = old_offset ? SLRDATA_MAIN_LISTHEADERSIZE + slrdata_read(6, d->ptr + old_offset) : 0;
+	uint_fast64_t offset = d->size < SLRDATA_MAIN_HEADERSIZE ? SLRDATA_MAIN_HEADERSIZE : d->size;
+
+	if (slrdata_resize(d, offset + list_size, false))
+		return(-1);
+
+	memcpy(d->ptr + offset, d->ptr + old_offset, list_size);
+	memset(d->ptr + SLRDATA_HEADERSIZE_BASIC, 0, SLRDATA_MAIN_HEADERSIZE - SLRDATA_HEADERSIZE_BASIC);
+	slrdata_write(8, d->ptr + SLRDATA_HEADERSIZE_BASIC, old_offset ? offset : 0);
+	slrdata_write(8, d->ptr + 8, SLRDATA_VERSION);
+	slrdata_refresh(d);
+
+	return(0);
+}
+
+// Make room in the element list for count more elements. The size in the
+// list header is the room reserved for elements. A list at the end of the
+// file grows in place, a list followed by sections is moved to the end of the
+// file with room to spare.
+static int slrdata_reserve_elements(slrdata_t *d, uint_fast64_t count)
+{
+	uint_fast64_t offset = slrdata_element_list_begin(d);
+	if (offset == 0)
+		return(-1);
+
+	uint_fast64_t room = slrdata_read(6, d->ptr + offset);
+	uint_fast64_t element_count = slrdata_read(6, d->ptr + offset + 6);
+	uint_fast64_t needed = (element_count + count) * SLRDATA_MAIN_ELEMENTSIZE;
+	if (needed <= room)
+		return(0);
+
+	if (offset + SLRDATA_MAIN_LISTHEADERSIZE + room == d->size)
+	{
+		if (slrdata_resize(d, offset + SLRDATA_MAIN_LISTHEADERSIZE + needed, false))
+			return(-1);
+
+		slrdata_write(6, d->ptr + offset, needed);
+		return(0);
+	}
+
+	if (needed < 2 * room)
+		needed = 2 * room;
+
+	uint_fast64_t new_offset = d->size;
+	if (slrdata_resize(d, new_offset + SLRDATA_MAIN_LISTHEADERSIZE + needed, false))
+		return(-1);
+
+	memcpy(d->ptr + new_offset, d->ptr + offset, SLRDATA_MAIN_LISTHEADERSIZE + element_count * SLRDATA_MAIN_ELEMENTSIZE);
+	slrdata_write(6, d->ptr + new_offset, needed);
+	slrdata_write(8, d->ptr + SLRDATA_HEADERSIZE_BASIC, new_offset);
+	slrdata_refresh(d);
+
+	return(0);
+}
+
+// Labels of elements are kept in three sections of the element file:
+// "lbloffs" holds the number of elements it covers and the offset of the label
+// of every element in "lblheap" (0 for none), "lblheap" its used size and the
+// labels with a terminating zero, and "lblindex" is an open addressing table
+// with its number of slots, the number of labels in it and element + 1 in
+// every used slot. The sections grow with room to spare so that labels added
+// one at a time do not move them every time. A section that is the last one in
+// the file grows in place; any other one is moved to the end of the file and
+// only its new copy stays in the section list. The bytes of the old copy are
+// not reused, which geometric growth keeps to less than the size of the
+// sections themselves.
+
+static uint64_t slrdata_label_hash(const char *label, size_t length)
+{
+	uint64_t h = 0xcbf29ce484222325;
+
+	for (size_t i = 0; i < length; i++)
+		h = (h ^ (unsigned char)label[i]) * 0x100000001b3;
+
+	return h;
+}
+
+// Put element id into the index unless an element with the same label is
+// already in it, so that a label finds the first element that has it
+static void slrdata_index_label(unsigned char *index, const unsigned char *offsets, const unsigned char *heap, uint_fast64_t id)
+{
+	uint_fast64_t slots = slrdata_read(8, index);
+	const char *label = (const char *)heap + slrdata_read(8, offsets + 8 + 8 * id);
+	uint_fast64_t slot = slrdata_label_hash(label, strlen(label)) & (slots - 1);
+	uint_fast64_t other;
+
+	// the offset of element other - 1 is at offsets + 8 * other
+	while ((other = slrdata_read(8, index + 16 + 8 * slot)))
+	{
+		if (strcmp((const char *)heap + slrdata_read(8, offsets + 8 * other), label) == 0)
+			return;
+
+		slot = (slot + 1) & (slots - 1);
+	}
+
+	slrdata_write(8, index + 16 + 8 * slot, id + 1);
+	slrdata_write(8, index + 8, slrdata_read(8, index + 8) + 1);
+}
+
+// Grow the label sections for labels of bytes bytes (with their terminating
+// zeros) of count of the first element_count elements, rebuilding the index
+// with twice the slots it needs if it gets more than half full
+static int slrdata_reserve_labels(slrdata_t *d, uint_fast64_t element_count, uint_fast64_t count, uint_fast64_t bytes)
+{
+	uint_fast64_t size = 0;
+	uint_fast64_t needed = 8 + 8 * element_count;
+	if (slrdata_section(d, "lbloffs", &size) == NULL || size < needed)
+	{
+		uint_fast64_t offset = slrdata_extend_section(d, "lbloffs", needed < 2 * size ? 2 * size : needed);
+		if (offset == 0)
+			return(-1);
+
+		if (size == 0)
+			slrdata_write(8, d->ptr + offset, 0);
+	}
+
+	size = 0;
+	const unsigned char *heap = slrdata_section(d, "lblheap", &size);
+	needed = (heap ? slrdata_read(8, heap) : 8) + bytes;
+	if (heap == NULL || size < needed)
+	{
+		uint_fast64_t offset = slrdata_extend_section(d, "lblheap", needed < 2 * size ? 2 * size : needed);
+		if (offset == 0)
+			return(-1);
+
+		if (size == 0)
+			slrdata_write(8, d->ptr + offset, 8);
+	}
+
+	const unsigned char *index = slrdata_section(d, "lblindex", NULL);
+	uint_fast64_t used = index ? slrdata_read(8, index + 8) : 0;
+	if (index && 2 * (used + count) <= slrdata_read(8, index))
+		return(0);
+
+	uint_fast64_t slots = 1024;
+	while (slots < 2 * (used + count))
+		slots *= 2;
+
+	// the index is rebuilt, so whatever extending it keeps is cleared
+	uint_fast64_t offset = slrdata_extend_section(d, "lblindex", 16 + 8 * slots);
+	if (offset == 0)
+		return(-1);
+
+	memset(d->ptr + offset, 0, 16 + 8 * slots);
+	slrdata_write(8, d->ptr + offset, slots);
+
+	const unsigned char *offsets = slrdata_section(d, "lbloffs", NULL);
+	heap = slrdata_section(d, "lblheap", NULL);
+	uint_fast64_t covered = slrdata_read(8, offsets);
+	for (uint_fast64_t id = 0; id < covered; id++)
+	{
+		if (slrdata_read(8, offsets + 8 + 8 * id))
+			slrdata_index_label(d->ptr + offset, offsets, heap, id);
+	}
+
+	return(0);
+}
+
+// Add count elements to the element file, growing it once. Element i gets
+// labels[i], which has lengths[i] bytes or is zero terminated if lengths is
+// NULL. Elements with a NULL label, or all if labels is NULL, get none.
+static int slrdata_add_labeled_elements(slrdata_t *d, const char *const *labels, const size_t *lengths, uint_fast64_t count)
+{
+	if (d->is_relation || d->readonly)
+		return(-1);
+
+	uint_fast64_t labeled = 0, bytes = 0;
+	for (uint_fast64_t i = 0; labels && i < count; i++)
+	{
+		if (labels[i])
+		{
+			labeled++;
+			bytes += (lengths ? lengths[i] : strlen(labels[i])) + 1;
+		}
+	}
+
+	if (labeled && slrdata_upgrade_element_file(d))
+		return(-1);
+
+	if (slrdata_reserve_elements(d, count))
+		return(-1);
+
+	uint_fast64_t first = d->element_count;
+	if (labeled && slrdata_reserve_labels(d, first + count, labeled, bytes))
+		return(-1);
+
+	// add elements
+	uint_fast64_t element_list_offset = slrdata_read(8, d->ptr + SLRDATA_HEADERSIZE_BASIC);
+	unsigned char *element = d->ptr + element_list_offset + SLRDATA_MAIN_LISTHEADERSIZE + first * SLRDATA_MAIN_ELEMENTSIZE;
+	for(uint_fast64_t i = 0; i < count; i++, element += SLRDATA_MAIN_ELEMENTSIZE)
+		slrdata_write(6, element, first + i + 1);
+
+	slrdata_write(6, d->ptr + element_list_offset + 6, first + count);
+
+	if (labeled)
+	{
+		unsigned char *offsets = slrdata_section(d, "lbloffs", NULL);
+		unsigned char *heap = slrdata_section(d, "lblheap", NULL);
+		unsigned char *index = slrdata_section(d, "lblindex", NULL);
+
+		// elements added without labels since the last labeled ones
+		for (uint_fast64_t id = slrdata_read(8, offsets); id < first; id++)
+			slrdata_write(8, offsets + 8 + 8 * id, 0);
+
+		uint_fast64_t used = slrdata_read(8, heap);
+		for (uint_fast64_t i = 0; i < count; i++)
+		{
+			if (labels[i] == NULL)
+			{
+				slrdata_write(8, offsets + 8 + 8 * (first + i), 0);
+				continue;
+			}
+
+			size_t length = lengths ? lengths[i] : strlen(labels[i]);
+			memcpy(heap + used, labels[i], length);
+			heap[used + length] = '\0';
+			slrdata_write(8, offsets + 8 + 8 * (first + i), used);
+			used += length + 1;
+		}
+		slrdata_write(8, offsets, first + count);
+		slrdata_write(8, heap, used);
+
+		for (uint_fast64_t i = 0; i < count; i++)
+		{
+			if (labels[i])
+				slrdata_index_label(index, offsets, heap, first + i);
+		}
+	}
+
+	slrdata_refresh(d);
+
+	return(0);
+}
+
+// Remove the elements from count on with their labels, undoing the additions
+// made since the element file had count elements. The room reserved for them
+// is kept.
+static void slrdata_drop_elements(slrdata_t *d, uint_fast64_t count)
+{
+	uint_fast64_t element_list_offset = slrdata_read(8, d->ptr + SLRDATA_HEADERSIZE_BASIC);
+	if (element_list_offset == 0 || count >= d->element_count)
+		return;
+
+	slrdata_write(6, d->ptr + element_list_offset + 6, count);
+
+	unsigned char *offsets = slrdata_section(d, "lbloffs", NULL);
+	if (offsets && slrdata_read(8, offsets) > count)
+	{
+		unsigned char *heap = slrdata_section(d, "lblheap", NULL);
+		unsigned char *index = slrdata_section(d, "lblindex", NULL);
+
+		// labels are in the heap in element order, the first dropped one
+		// starts the unused part
+		for (uint_fast64_t id = slrdata_read(8, offsets); id-- > count;)
+		{
+			if (slrdata_read(8, offsets + 8 + 8 * id))
+				slrdata_write(8, heap, slrdata_read(8, offsets + 8 + 8 * id));
+		}
+		slrdata_write(8, offsets, count);
+
+		uint_fast64_t slots = slrdata_read(8, index);
+		memset(index + 8, 0, 8 + 8 * slots);
+		for (uint_fast64_t id = 0; id < count; id++)
+		{
+			if (slrdata_read(8, offsets + 8 + 8 * id))
+				slrdata_index_label(index, offsets, heap, id);
+		}
+	}
+
+	slrdata_refresh(d);
+}
+
+// add elements to element file, growing it once
+int slrdata_add_elements(slrdata_t *d, const char *const *labels, uint_fast64_t count)
+{
+	return slrdata_add_labeled_elements(d, labels, NULL, count);
+}
+
+// add element to element file
+int slrdata_add_element(slrdata_t *d, const char *restrict label)
+{
+	const char *labels[1] = { label };
+
+	return slrdata_add_elements(d, labels, 1);
+}
+
+// Label of element id, NULL if it has none. It points into the mapping and is
+// valid until the file is changed.
+const char * slrdata_element_label(slrdata_t *d, uint_fast64_t id)
+{
+	if (d->label_offsets == NULL || id >= slrdata_read(8, d->label_offsets))
+		return NULL;
+
+	uint_fast64_t offset = slrdata_read(8, d->label_offsets + 8 + 8 * id);
+
+	return offset ? (const char *)d->label_heap + offset : NULL;
+}
+
+// First element with the label of length bytes, or -1 if there is none
+uint_fast64_t slrdata_find_element(slrdata_t *d, const char *label, size_t length)
+{
+	SLRDATA_STATS_QUERY(d, SLRDATA_STAT_LOOKUP, 1);
+	if (d->label_index == NULL)
+		return -1;
+
+	uint_fast64_t slots = slrdata_read(8, d->label_index);
+	uint_fast64_t slot = slrdata_label_hash(label, length) & (slots - 1);
+	uint_fast64_t id;
+
+	while ((id = slrdata_read(8, d->label_index + 16 + 8 * slot)))
+	{
+		const char *other = (const char *)d->label_heap + slrdata_read(8, d->label_offsets + 8 * id);
+		if (strncmp(other, label, length) == 0 && other[length] == '\0')
+			return id - 1;
+
+		slot = (slot + 1) & (slots - 1);
+	}
+
+	return -1;
+}
+
+// Relation list of the element file, NULL if it has none. Version 1 element
+// files have no relation list offset.
+static const unsigned char * slrdata_catalog(slrdata_t *d)
+{
+	if (d->is_relation || d->version < 2)
+		return NULL;
+
+	uint_fast64_t offset = slrdata_read(8, d->ptr + SLRDATA_HEADERSIZE_BASIC + 8);
+
+	return offset ? d->ptr + offset : NULL;
+}
+
+// Index of the relation in the catalog, -1 if it is not in it
+static uint_fast64_t slrdata_catalog_find(slrdata_t *d, const char *name)
+{
+	const unsigned char *catalog = slrdata_catalog(d);
+	if (catalog == NULL)
+		return -1;
+
+	uint_fast64_t count = slrdata_read(6, catalog + 6);
+	uint_fast64_t slots = slrdata_read(8, catalog + SLRDATA_MAIN_LISTHEADERSIZE);
+	const unsigned char *entries = catalog + SLRDATA_MAIN_CATALOGHEADERSIZE;
+	const unsigned char *table = entries + count * SLRDATA_MAIN_RELATIONSIZE;
+	uint_fast64_t slot = slrdata_label_hash(name, strlen(name)) & (slots - 1);
+	uint_fast64_t i;
+
+	while ((i = slrdata_read(8, table + 8 * slot)))
+	{
+		const unsigned char *entry = entries + (i - 1) * SLRDATA_MAIN_RELATIONSIZE;
+		if (strcmp((const char *)catalog + slrdata_read(8, entry), name) == 0)
+			return i - 1;
+
+		slot = (slot + 1) & (slots - 1);
+	}
+
+	return -1;
+}
+
+// Catalog entry i of the element file. The name points into the mapping and
+// is valid until the file is changed.
+int slrdata_relation_info(slrdata_t *d, uint_fast64_t i, struct slrdata_relation_info *info)
+{
+	const unsigned char *catalog = slrdata_catalog(d);
+	if (catalog == NULL || i >= slrdata_read(6, catalog + 6))
+		return(-1);
+
+	const unsigned char *entry = catalog + SLRDATA_MAIN_CATALOGHEADERSIZE + i * SLRDATA_MAIN_RELATIONSIZE;
+	info->name = (const char *)catalog + slrdata_read(8, entry);
+	info->arity = slrdata_read(8, entry + 8);
+	info->tuple_count = slrdata_read(8, entry + 16);
+	info->size = slrdata_read(8, entry + 24);
+
+	return(0);
+}
+
+// Add the relation to the catalog of the element file of its folder, or
+// update its entry. The catalog is small and written anew at the end of the
+// file every time.
+int slrdata_add_relation(slrdata_t *elements, slrdata_t *relation)
+{
+	if (elements->is_relation || elements->readonly || !relation->is_relation || relation->filename == NULL)
+		return(-1);
+
+	if (slrdata_upgrade_element_file(elements))
+		return(-1);
+
+	// the entries are copied out, the old catalog may move when the file grows
+	const unsigned char *catalog = slrdata_catalog(elements);
+	uint_fast64_t old_count = catalog ? slrdata_read(6, catalog + 6) : 0;
+	uint_fast64_t index = slrdata_catalog_find(elements, relation->filename);
+	uint_fast64_t count = old_count + (index == (uint_fast64_t)-1);
+	struct slrdata_relation_info *infos = malloc(count * sizeof(struct slrdata_relation_info));
+	char *names = NULL;
+	if (infos == NULL)
+		return(-1);
+
+	uint_fast64_t names_size = 0;
+	for (uint_fast64_t i = 0; i < old_count; i++)
+	{
+		slrdata_relation_info(elements, i, &infos[i]);
+		names_size += strlen(infos[i].name) + 1;
+	}
+
+	if (index == (uint_fast64_t)-1)
+	{
+		index = old_count;
+		names_size += strlen(relation->filename) + 1;
+	}
+	infos[index].name = relation->filename;
+	infos[index].arity = relation->arity;
+	infos[index].tuple_count = slrdata_tuple_count(relation);
+	infos[index].size = relation->size;
+
+	if ((names = malloc(names_size)) == NULL)
+	{
+		free(infos);
+		return(-1);
+	}
+
+	char *name = names;
+	for (uint_fast64_t i = 0; i < count; i++)
+	{
+		size_t length = strlen(infos[i].name) + 1;
+		memcpy(name, infos[i].name, length);
+		infos[i].name = name;
+		name += length;
+	}
+
+	uint_fast64_t slots = 8;
+	while (slots < 2 * count)
+		slots *= 2;
+
+	uint_fast64_t offset = (elements->size + 7) & ~(uint_fast64_t)7;
+	uint_fast64_t names_offset = SLRDATA_MAIN_CATALOGHEADERSIZE + count * SLRDATA_MAIN_RELATIONSIZE + slots * 8;
+	if (slrdata_resize(elements, offset + names_offset + names_size, false))
+	{
+		free(names);
+		free(infos);
+		return(-1);
+	}
+
+	unsigned char *list = elements->ptr + offset;
+	unsigned char *table = list + SLRDATA_MAIN_CATALOGHEADERSIZE + count * SLRDATA_MAIN_RELATIONSIZE;
+	slrdata_write(6, list, names_offset + names_size - SLRDATA_MAIN_LISTHEADERSIZE);
+	slrdata_write(6, list + 6, count);
+	slrdata_write(8, list + SLRDATA_MAIN_LISTHEADERSIZE, slots);
+	memset(table, 0, slots * 8);
+	memcpy(list + names_offset, names, names_size);
+
+	for (uint_fast64_t i = 0; i < count; i++)
+	{
+		unsigned char *entry = list + SLRDATA_MAIN_CATALOGHEADERSIZE + i * SLRDATA_MAIN_RELATIONSIZE;
+		slrdata_write(8, entry, names_offset + (infos[i].name - names));
+		slrdata_write(8, entry + 8, infos[i].arity);
+		slrdata_write(8, entry + 16, infos[i].tuple_count);
+		slrdata_write(8, entry + 24, infos[i].size);
+
+		uint_fast64_t slot = slrdata_label_hash(infos[i].name, strlen(infos[i].name)) & (slots - 1);
+		while (slrdata_read(8, table + 8 * slot))
+			slot = (slot + 1) & (slots - 1);
+		slrdata_write(8, table + 8 * slot, i + 1);
+	}
+
+	slrdata_write(8, elements->ptr + SLRDATA_HEADERSIZE_BASIC + 8, offset);
+	free(names);
+	free(infos);
+
+	return(0);
+}
+
+// Open the element file of the folder and every relation in its catalog. The
+// relations are opened relative to the folder, their headers checked with a
+// single read each, and mapped with the hints. A relation of the catalog that
+// cannot be opened fails the whole call.
+int slrdata_open_database(slrdata_database_t *db, const char *restrict foldername, bool readonly, unsigned hints)
+{
+	db->relation_count = 0;
+	db->relations = NULL;
+	db->names = NULL;
+
+	if (slrdata_open_hinted(&db->elements, foldername, "elements", readonly, false, hints))
+		return(-1);
+
+	const unsigned char *catalog = slrdata_catalog(&db->elements);
+	uint_fast64_t count = catalog ? slrdata_read(6, catalog + 6) : 0;
+	if (count == 0)
+		return(0);
+
+	// the names are copied, a writable element file may be remapped
+	uint_fast64_t names_offset = SLRDATA_MAIN_CATALOGHEADERSIZE + count * SLRDATA_MAIN_RELATIONSIZE + slrdata_read(8, catalog + SLRDATA_MAIN_LISTHEADERSIZE) * 8;
+	uint_fast64_t names_size = SLRDATA_MAIN_LISTHEADERSIZE + slrdata_read(6, catalog) - names_offset;
+	int dir = open(foldername, O_RDONLY | O_DIRECTORY);
+	db->relations = calloc(count, sizeof(slrdata_t));
+	db->names = malloc(names_size);
+	if (dir == -1 || db->relations == NULL || db->names == NULL)
+		goto fail;
+
+	memcpy(db->names, catalog + names_offset, names_size);
+
+	for (; db->relation_count < count; db->relation_count++)
+	{
+		const unsigned char *entry = catalog + SLRDATA_MAIN_CATALOGHEADERSIZE + db->relation_count * SLRDATA_MAIN_RELATIONSIZE;
+		const char *name = db->names + slrdata_read(8, entry) - names_offset;
+		slrdata_t *relation = &db->relations[db->relation_count];
+
+		char filename[strlen(name) + 5];
+		strcat(strcpy(filename, name), ".sld");
+		if ((relation->fd = openat(dir, filename, readonly ? O_RDONLY : O_RDWR)) == -1
+				|| slrdata_map_file(relation, foldername, name, readonly, true, hints))
+			goto fail;
+	}
+
+	close(dir);
+
+	return(0);
+
+fail:
+	if (dir != -1)
+		close(dir);
+	slrdata_close_database(db);
+
+	return(-1);
+}
+
+// Relation of the database with the given name, NULL if there is none
+slrdata_t * slrdata_database_relation(slrdata_database_t *db, const char *name)
+{
+	uint_fast64_t i = slrdata_catalog_find(&db->elements, name);
+
+	return i < db->relation_count ? &db->relations[i] : NULL;
+}
+
+void slrdata_close_database(slrdata_database_t *db)
+{
+	for (uint_fast64_t i = 0; i < db->relation_count; i++)
+		slrdata_close(&db->relations[i]);
+
+	slrdata_close(&db->elements);
+	free(db->relations);
+	free(db->names);
+	db->relation_count = 0;
+	db->relations = NULL;
+	db->names = NULL;
+}
+
+// Start the tuple list if the relation file does not have one yet. Tuples can
+// only be added while the tuple list is at the end of the file, before any
+// element list or section. Returns the offset of the tuple list or 0 if tuples
+// cannot be added.
+static uint_fast64_t slrdata_tuple_list_begin(slrdata_t *d, uint_fast64_t arity)
+{
+	uint_fast64_t tuple_list_offset = slrdata_read(8, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC);
+	uint_fast64_t field = slrdata_section_list_field(d);
+	if (slrdata_read(8, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 8) || (field && slrdata_read(8, d->ptr + field)))
+		return(0);
+
+	if (tuple_list_offset == 0)
+	{
+		tuple_list_offset = slrdata_list_align(d->width, slrdata_relation_headersize(d));
+		// update tuple list offset and arity
+		slrdata_write(8, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC, tuple_list_offset);
+		slrdata_write(6, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 16, arity);
+
+		// resize
+		if(slrdata_resize(d, tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE, true))
+			return(0);
+
+		// add tuple list header
+		slrdata_write(6, d->ptr + tuple_list_offset, 0);
+		slrdata_write(6, d->ptr + tuple_list_offset + 6, 0);
+		slrdata_refresh(d);
+	}
+	else
+	{
+		uint_fast64_t list_end = tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + slrdata_read(6, d->ptr + tuple_list_offset);
+		if (slrdata_arity(d) != arity || list_end != d->size)
+			return(0);
+	}
+
+	return(tuple_list_offset);
+}
+
+// Move the columns of a columnar tuple list with count tuples from room for
+// from tuples each to room for to tuples each. The mapping must hold both.
+static void slrdata_move_columns(unsigned char *columns, uint_fast8_t width, uint_fast64_t arity, uint_fast64_t count, uint_fast64_t from, uint_fast64_t to)
+{
+	if (to > from)
+	{
+		for (uint_fast64_t j = arity; j-- > 1;)
+			memmove(columns + j * to * width, columns + j * from * width, count * width);
+	}
+	else
+	{
+		for (uint_fast64_t j = 1; j < arity; j++)
+			memmove(columns + j * to * width, columns + j * from * width, count * width);
+	}
+}
+
+// Give the columns of the columnar tuple list at the end of the file room for
+// capacity tuples, of which the first count are kept
+static int slrdata_resize_columns(slrdata_t *d, uint_fast64_t tuple_list_offset, uint_fast64_t count, uint_fast64_t capacity)
+{
+	uint_fast64_t arity = slrdata_read(6, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 16);
+	uint_fast64_t old_capacity = arity ? slrdata_read(6, d->ptr + tuple_list_offset) / (arity * d->width) : 0;
+	uint_fast64_t size = tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + capacity * arity * d->width;
+
+	if (capacity > old_capacity && slrdata_resize(d, size, true))
+		return(-1);
+
+	slrdata_move_columns(d->ptr + tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE, d->width, arity, count, old_capacity, capacity);
+	slrdata_write(6, d->ptr + tuple_list_offset, capacity * arity * d->width);
+
+	return slrdata_resize(d, size, true);
+}
+
+// Drop the room left in the columns of a columnar tuple list before anything
+// is added after it
+static int slrdata_fit_columns(slrdata_t *d)
+{
+	if (!d->columnar || d->tuple_list == NULL || d->element_list || d->column_stride == d->tuple_count)
+		return(0);
+
+	return slrdata_resize_columns(d, d->tuple_list - SLRDATA_RELATION_LISTHEADERSIZE - d->ptr, d->tuple_count, d->tuple_count);
+}
+
+// add count tuples stored one after another in tuples, growing the file once
+int slrdata_add_tuples(slrdata_t *d, const uint_fast64_t *tuples, uint_fast64_t count, uint_fast64_t arity)
+{
+	uint_fast64_t tuple_list_offset = slrdata_tuple_list_begin(d, arity);
+	if (tuple_list_offset == 0)
+		return(-1);
+
+	uint_fast64_t list_size = slrdata_read(6, d->ptr + tuple_list_offset);
+	uint_fast64_t tuple_count = slrdata_read(6, d->ptr + tuple_list_offset + 6);
+	uint_fast8_t width = d->width;
+
+	for(uint_fast64_t i = 0; i < count * arity; i++)
+		if(!slrdata_fits(width, tuples[i]))
+			return(-1);
+
+	if(d->columnar)
+	{
+		// the columns grow geometrically, the room left is dropped once
+		// incidence lists are added
+		uint_fast64_t capacity = d->column_stride;
+		if(tuple_count + count > capacity)
+		{
+			capacity += capacity / 2;
+			if(capacity < tuple_count + count)
+				capacity = tuple_count + count;
+
+			if(slrdata_resize_columns(d, tuple_list_offset, tuple_count, capacity))
+				return(-1);
+		}
+
+		unsigned char *columns = d->ptr + tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE;
+		for(uint_fast64_t i = 0; i < count; i++)
+			for(uint_fast64_t j = 0; j < arity; j++)
+				slrdata_set(width, columns, j * capacity + tuple_count + i, tuples[i * arity + j]);
+
+		slrdata_write(6, d->ptr + tuple_list_offset + 6, tuple_count + count);
+		slrdata_refresh(d);
+
+		return(0);
+	}
+
+	// resize
+	if(slrdata_resize(d, d->size + count * (arity * width), true))
+		return(-1);
+
+	// update tuple list header
+	slrdata_write(6, d->ptr + tuple_list_offset, list_size + count * (arity * width));
+	slrdata_write(6, d->ptr + tuple_list_offset + 6, tuple_count + count);
+
+	// add tuples
+	unsigned char *element = d->ptr + tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + list_size;
+	for(uint_fast64_t i = 0; i < count * arity; i++)
+		slrdata_set(width, element, i, tuples[i]);
+
+	slrdata_refresh(d);
+
+	return(0);
+}
+
+int slrdata_add_tuple(slrdata_t *d, uint_fast64_t * tuple, uint_fast64_t arity)
+{
+	return slrdata_add_tuples(d, tuple, 1, arity);
+}
+
+// The builder appends tuples straight into the mapping. The tuple list header
+// and the file size are only written, and the file trimmed, by
+// slrdata_builder_finish.
+int slrdata_builder_init(slrdata_builder_t *b, slrdata_t *relation, uint_fast64_t arity)
+{
+	uint_fast64_t tuple_list_offset = slrdata_tuple_list_begin(relation, arity);
+	if (tuple_list_offset == 0)
+		return(-1);
+
+	b->relation = relation;
+	b->arity = arity;
+	b->tuple_list_offset = tuple_list_offset;
+	b->tuple_count = slrdata_read(6, relation->ptr + tuple_list_offset + 6);
+	b->capacity = relation->column_stride;
+
+	return(0);
+}
+
+int slrdata_builder_add(slrdata_builder_t *b, const uint_fast64_t *tuple)
+{
+	uint_fast8_t width = b->relation->width;
+	uint_fast64_t tuple_size = b->arity * width;
+	uint_fast64_t tuple_offset = b->tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + b->tuple_count * tuple_size;
+
+	for(uint_fast64_t i = 0; i < b->arity; i++)
+		if(!slrdata_fits(width, tuple[i]))
+			return(-1);
+
+	if(b->relation->columnar)
+	{
+		if(b->tuple_count == b->capacity)
+		{
+			uint_fast64_t capacity = b->capacity < 64 ? 64 : b->capacity + b->capacity / 2;
+			if(slrdata_resize_columns(b->relation, b->tuple_list_offset, b->tuple_count, capacity))
+				return(-1);
+			b->capacity = capacity;
+		}
+
+		unsigned char *columns = b->relation->ptr + b->tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE;
+		for(uint_fast64_t i = 0; i < b->arity; i++)
+			slrdata_set(width, columns, i * b->capacity + b->tuple_count, tuple[i]);
+
+		b->tuple_count++;
+
+		return(0);
+	}
+
+	if(slrdata_reserve(b->relation, tuple_offset + tuple_size))
+		return(-1);
+
+	unsigned char *element = b->relation->ptr + tuple_offset;
+	for(uint_fast64_t i = 0; i < b->arity; i++)
+		slrdata_set(width, element, i, tuple[i]);
+
+	b->tuple_count++;
+
+	return(0);
+}
+
+int slrdata_builder_finish(slrdata_builder_t *b)
+{
+	slrdata_t *d = b->relation;
+	uint_fast64_t list_size = b->tuple_count * (b->arity * d->width);
+
+	if(d->columnar && slrdata_resize_columns(d, b->tuple_list_offset, b->tuple_count, b->tuple_count))
+		return(-1);
+
+	if(slrdata_resize(d, b->tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + list_size, true))
+		return(-1);
+
+	// update tuple list header
+	slrdata_write(6, d->ptr + b->tuple_list_offset, list_size);
+	slrdata_write(6, d->ptr + b->tuple_list_offset + 6, b->tuple_count);
+	slrdata_refresh(d);
+
+	return slrdata_trim(d);
+}
+
+int slrdata_add_incidence_lists(slrdata_t *relation, slrdata_t *elements, uint_fast64_t norm_degree, uint_fast64_t max_degree)
+{
+	if(slrdata_fit_columns(relation))
+		return(-1);
+
+	uint_fast64_t element_count = slrdata_element_count(elements);
+	uint_fast64_t arity = slrdata_arity(relation);
+	uint_fast64_t element_list_offset = slrdata_list_align(relation->width, relation->size);
+	uint_fast64_t tuple_count = relation->tuple_count;
+	uint_fast8_t width = relation->width;
+
+	// update element list offset
+	slrdata_write(8, relation->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 8, element_list_offset);
+
+	// resize
+	uint_fast64_t new_size = element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + element_count * (SLRDATA_RELATION_ELEMENTSIZE);
+	slrdata_resize(relation, new_size, true);
+
+	// element list header
+	uint_fast64_t list_size = element_count * SLRDATA_RELATION_ELEMENTSIZE;
+	slrdata_write(6, relation->ptr + element_list_offset, list_size);
+	slrdata_write(6, relation->ptr + element_list_offset + 6, element_count);
+	slrdata_refresh(relation);
+
+	// element and incidence lists
+	for(uint_fast64_t i = 0; i < element_count; i++)
+	{
+		uint_fast64_t element_offset = element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (i * SLRDATA_RELATION_ELEMENTSIZE);
+		uint_fast64_t incidence_list_offset = slrdata_list_align(width, relation->size);
+
+		slrdata_write(8, relation->ptr + element_offset, incidence_list_offset);
+		slrdata_resize(relation, incidence_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (norm_degree * width), true);
+
+		// incidence list header
+		slrdata_write(6, relation->ptr + incidence_list_offset, norm_degree * width);
+		slrdata_write(6, relation->ptr + incidence_list_offset + 6, 0);
+	}
+
+	for(uint_fast64_t i = 0; i < tuple_count; i++)
+	{
+		uint_fast64_t *tuple;
+		tuple = slrdata_ith_tuple(relation, i);
+
+		for(int a = 0; a < arity; a++)
+		{
+			uint_fast64_t element_offset = element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (tuple[a] * SLRDATA_RELATION_ELEMENTSIZE);
+			uint_fast64_t element_incidence_list_offset = slrdata_read(8, relation->ptr + element_offset);
+			uint_fast64_t old_degree = slrdata_read(6, relation->ptr + element_incidence_list_offset + 6);
+			uint_fast64_t current_list_size = slrdata_read(6, relation->ptr + element_incidence_list_offset);
+
+			if(old_degree + 1 > max_degree)
+			{
+				free(tuple);
+				return(-1);
+			}
+
+			if((old_degree + 1) * width > current_list_size)
+			{
+				// incidence list offset
+				uint_fast64_t new_incidence_list_offset = slrdata_list_align(width, relation->size);
+				slrdata_write(8, relation->ptr + element_offset, new_incidence_list_offset);
+				slrdata_resize(relation, new_incidence_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + current_list_size + (norm_degree * width), true);
+
+				// header
+				memcpy(relation->ptr + new_incidence_list_offset, relation->ptr + element_incidence_list_offset, SLRDATA_RELATION_LISTHEADERSIZE + (old_degree * width));
+				slrdata_write(6, relation->ptr + new_incidence_list_offset, current_list_size + (norm_degree * width));
+				slrdata_write(6, relation->ptr + new_incidence_list_offset + 6, old_degree + 1);
+
+				slrdata_set(width, relation->ptr + new_incidence_list_offset + SLRDATA_RELATION_LISTHEADERSIZE, old_degree, i);
+			}
+			else{
+				// update degree
+				slrdata_write(6, relation->ptr + element_incidence_list_offset + 6, old_degree + 1);
+				// add tuple index
+				slrdata_set(width, relation->ptr + element_incidence_list_offset + SLRDATA_RELATION_LISTHEADERSIZE, old_degree, i);
+			}
+		}
+
+		free(tuple);
+	}
+
+	return(0);
+}
+
+// Append tuple index i to the incidence list of e, whose degree counts the
+// incidences added so far
+static inline void slrdata_append_incidence(unsigned char *ptr, const unsigned char *element_list, uint_fast8_t width, uint_fast64_t e, uint_fast64_t i)
+{
+	unsigned char *incidence_list = ptr + slrdata_read(8, element_list + e * SLRDATA_RELATION_ELEMENTSIZE);
+	uint_fast64_t degree = slrdata_read(6, incidence_list + 6);
+
+	slrdata_set(width, incidence_list + SLRDATA_RELATION_LISTHEADERSIZE, degree, i);
+	slrdata_write(6, incidence_list + 6, degree + 1);
+}
+
+// Build compact incidence lists in two passes over the tuple list. The degree
+// of every element is first counted in its element list entry, the entries are
+// then turned into incidence list offsets by a prefix sum and the lists are
+// filled in tuple order. The file is resized once and has no unused space.
+int slrdata_build_incidence_lists(slrdata_t *relation, slrdata_t *elements, uint_fast64_t max_degree)
+{
+	if(slrdata_fit_columns(relation))
+		return(-1);
+
+	uint_fast64_t element_count = slrdata_element_count(elements);
+	uint_fast64_t arity = slrdata_arity(relation);
+	uint_fast64_t tuple_count = relation->tuple_count;
+	uint_fast64_t tuple_list_offset = slrdata_read(8, relation->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC);
+	uint_fast8_t width = relation->width;
+	uint_fast64_t old_size = relation->size;
+	uint_fast64_t element_list_offset = slrdata_list_align(width, old_size);
+	uint_fast64_t incidence_lists_offset = slrdata_list_align(width, element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + element_count * SLRDATA_RELATION_ELEMENTSIZE);
+
+	// every tuple adds one incidence per position, this is exact unless list
+	// bodies are padded to the alignment
+	uint_fast64_t new_size = incidence_lists_offset + element_count * slrdata_list_stride(width, 0) + tuple_count * arity * width;
+	if(slrdata_resize(relation, new_size, true))
+		return(-1);
+
+	unsigned char *element_list = relation->ptr + element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE;
+	const unsigned char *tuple_list = relation->ptr + tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE;
+
+	// element list header
+	slrdata_write(6, relation->ptr + element_list_offset, element_count * SLRDATA_RELATION_ELEMENTSIZE);
+	slrdata_write(6, relation->ptr + element_list_offset + 6, element_count);
+	memset(element_list, 0, element_count * SLRDATA_RELATION_ELEMENTSIZE);
+
+	// count degrees, the order does not matter so columns are read as they are
+	uint64_t block[SLRDATA_SCAN_BLOCK];
+	for(uint_fast64_t start = 0; start < tuple_count * arity; start += SLRDATA_SCAN_BLOCK)
+	{
+		uint_fast64_t n = tuple_count * arity - start < SLRDATA_SCAN_BLOCK ? tuple_count * arity - start : SLRDATA_SCAN_BLOCK;
+		slrdata_decode(width, tuple_list + start * width, block, n);
+
+		for(uint_fast64_t j = 0; j < n; j++)
+		{
+			uint_fast64_t e = block[j];
+			if(e >= element_count)
+				goto fail;
+
+			unsigned char *element = element_list + e * SLRDATA_RELATION_ELEMENTSIZE;
+			uint_fast64_t degree = slrdata_read(8, element) + 1;
+			if(degree > max_degree)
+				goto fail;
+
+			slrdata_write(8, element, degree);
+		}
+	}
+
+	// lay out the incidence lists, their degree counts the incidences added so far
+	uint_fast64_t incidence_list_offset = incidence_lists_offset;
+	for(uint_fast64_t e = 0; e < element_count; e++)
+	{
+		unsigned char *element = element_list + e * SLRDATA_RELATION_ELEMENTSIZE;
+		uint_fast64_t degree = slrdata_read(8, element);
+
+		slrdata_write(8, element, incidence_list_offset);
+		slrdata_write(6, relation->ptr + incidence_list_offset, degree * width);
+		slrdata_write(6, relation->ptr + incidence_list_offset + 6, 0);
+
+		incidence_list_offset += slrdata_list_stride(width, degree * width);
+	}
+
+	// fill the incidence lists, in tuple order
+	if(relation->column_stride == 0)
+	{
+		uint_fast64_t i = 0, a = 0;
+		for(uint_fast64_t start = 0; start < tuple_count * arity; start += SLRDATA_SCAN_BLOCK)
+		{
+			uint_fast64_t n = tuple_count * arity - start < SLRDATA_SCAN_BLOCK ? tuple_count * arity - start : SLRDATA_SCAN_BLOCK;
+			slrdata_decode(width, tuple_list + start * width, block, n);
+
+			for(uint_fast64_t j = 0; j < n; j++)
+			{
+				slrdata_append_incidence(relation->ptr, element_list, width, block[j], i);
+
+				// position within the tuple
+				if(++a == arity)
+				{
+					a = 0;
+					i++;
+				}
+			}
+		}
+	}
+	else
+	{
+		for(uint_fast64_t i = 0; i < tuple_count; i++)
+			for(uint_fast64_t a = 0; a < arity; a++)
+				slrdata_append_incidence(relation->ptr, element_list, width, slrdata_tuple_field(relation, i, a), i);
+	}
+
+	// update element list offset
+	slrdata_write(8, relation->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 8, element_list_offset);
+	if(slrdata_resize(relation, incidence_list_offset, true))
+		return(-1);
+
+	return slrdata_trim(relation);
+
+fail:
+	slrdata_resize(relation, old_size, true);
+	slrdata_trim(relation);
+	return(-1);
+}
+
+struct slrdata_build_job
+{
+	unsigned char *ptr;
+	const unsigned char *tuple_list;
+	unsigned char *element_list;
+	uint_fast8_t width;
+	uint_fast64_t column_stride;
+	uint_fast64_t arity;
+	uint_fast64_t tuple_count;
+	uint_fast64_t element_count;
+	uint_fast64_t max_degree;
+	uint_fast64_t incidence_lists_offset;
+	unsigned threads;
+	// counts[t * element_count + e]: incidences of e in the tuples of thread t,
+	// later the position in the incidence list of e where thread t writes next
+	uint_fast64_t *counts;
+	// bytes taken by the incidence lists of the elements of thread t
+	uint_fast64_t *chunk_sizes;
+	bool failed;
+};
+
+struct slrdata_build_worker
+{
+	struct slrdata_build_job *job;
+	unsigned t;
+	void (*phase)(struct slrdata_build_job *job, unsigned t);
+	pthread_t thread;
+};
+
+// Thread t owns a contiguous range of tuples and a contiguous range of
+// elements. Since the incidences of thread t are written after those of the
+// threads before it, every list ends up in tuple order exactly as in the
+// serial build.
+static void slrdata_build_range(uint_fast64_t count, struct slrdata_build_job *job, unsigned t, uint_fast64_t *first, uint_fast64_t *last)
+{
+	*first = count * t / job->threads;
+	*last = count * (t + 1) / job->threads;
+}
+
+// count the incidences in the tuples of thread t
+static void slrdata_build_count(struct slrdata_build_job *job, unsigned t)
+{
+	uint_fast64_t *counts = job->counts + t * job->element_count;
+	uint_fast64_t first, last;
+	uint64_t block[SLRDATA_SCAN_BLOCK];
+
+	slrdata_build_range(job->tuple_count, job, t, &first, &last);
+
+	// the fields of the tuples are one run of rows or one run per column
+	uint_fast64_t runs = job->column_stride ? job->arity : 1;
+	for(uint_fast64_t r = 0; r < runs; r++)
+	{
+		uint_fast64_t begin = job->column_stride ? r * job->column_stride + first : first * job->arity;
+		uint_fast64_t end = job->column_stride ? r * job->column_stride + last : last * job->arity;
+
+		for(uint_fast64_t start = begin; start < end; start += SLRDATA_SCAN_BLOCK)
+		{
+			uint_fast64_t n = end - start < SLRDATA_SCAN_BLOCK ? end - start : SLRDATA_SCAN_BLOCK;
+			slrdata_decode(job->width, job->tuple_list + start * job->width, block, n);
+
+			for(uint_fast64_t j = 0; j < n; j++)
+			{
+				if(block[j] >= job->element_count)
+				{
+					__atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+					return;
+				}
+
+				counts[block[j]]++;
+			}
+		}
+	}
+}
+
+// merge the counts of the elements of thread t into per thread positions,
+// keeping the degree in the element list entry
+static void slrdata_build_merge(struct slrdata_build_job *job, unsigned t)
+{
+	uint_fast64_t n = job->element_count;
+	uint_fast64_t first, last;
+	uint_fast64_t chunk_size = 0;
+
+	slrdata_build_range(n, job, t, &first, &last);
+
+	for(uint_fast64_t e = first; e < last; e++)
+	{
+		uint_fast64_t degree = 0;
+		for(unsigned u = 0; u < job->threads; u++)
+		{
+			uint_fast64_t count = job->counts[u * n + e];
+			job->counts[u * n + e] = degree;
+			degree += count;
+		}
+
+		if(degree > job->max_degree)
+			__atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+
+		slrdata_write(8, job->element_list + e * SLRDATA_RELATION_ELEMENTSIZE, degree);
+		chunk_size += slrdata_list_stride(job->width, degree * job->width);
+	}
+
+	job->chunk_sizes[t] = chunk_size;
+}
+
+// lay out the incidence lists of the elements of thread t
+static void slrdata_build_layout(struct slrdata_build_job *job, unsigned t)
+{
+	uint_fast64_t first, last;
+	uint_fast64_t incidence_list_offset = job->incidence_lists_offset;
+
+	slrdata_build_range(job->element_count, job, t, &first, &last);
+
+	for(unsigned u = 0; u < t; u++)
+		incidence_list_offset += job->chunk_sizes[u];
+
+	for(uint_fast64_t e = first; e < last; e++)
+	{
+		unsigned char *element = job->element_list + e * SLRDATA_RELATION_ELEMENTSIZE;
+		uint_fast64_t degree = slrdata_read(8, element);
+
+		slrdata_write(8, element, incidence_list_offset);
+		slrdata_write(6, job->ptr + incidence_list_offset, degree * job->width);
+		slrdata_write(6, job->ptr + incidence_list_offset + 6, degree);
+
+		incidence_list_offset += slrdata_list_stride(job->width, degree * job->width);
+	}
+}
+
+// write the indices of the tuples of thread t into the incidence lists
+static void slrdata_build_scatter(struct slrdata_build_job *job, unsigned t)
+{
+	uint_fast64_t *counts = job->counts + t * job->element_count;
+	uint_fast64_t first, last;
+	uint64_t block[SLRDATA_SCAN_BLOCK];
+
+	slrdata_build_range(job->tuple_count, job, t, &first, &last);
+
+	if(job->column_stride)
+	{
+		for(uint_fast64_t i = first; i < last; i++)
+		{
+			for(uint_fast64_t a = 0; a < job->arity; a++)
+			{
+				uint_fast64_t e = slrdata_get(job->width, job->tuple_list, a * job->column_stride + i);
+				unsigned char *incidence_list = job->ptr + slrdata_read(8, job->element_list + e * SLRDATA_RELATION_ELEMENTSIZE);
+				slrdata_set(job->width, incidence_list + SLRDATA_RELATION_LISTHEADERSIZE, counts[e]++, i);
+			}
+		}
+		return;
+	}
+
+	uint_fast64_t i = first, a = 0;
+	for(uint_fast64_t start = first * job->arity; start < last * job->arity; start += SLRDATA_SCAN_BLOCK)
+	{
+		uint_fast64_t n = last * job->arity - start < SLRDATA_SCAN_BLOCK ? last * job->arity - start : SLRDATA_SCAN_BLOCK;
+		slrdata_decode(job->width, job->tuple_list + start * job->width, block, n);
+
+		for(uint_fast64_t j = 0; j < n; j++)
+		{
+			unsigned char *incidence_list = job->ptr + slrdata_read(8, job->element_list + block[j] * SLRDATA_RELATION_ELEMENTSIZE);
+			slrdata_set(job->width, incidence_list + SLRDATA_RELATION_LISTHEADERSIZE, counts[block[j]]++, i);
+
+			if(++a == job->arity)
+			{
+				a = 0;
+				i++;
+			}
+		}
+	}
+}
+
+static void * slrdata_build_thread(void *arg)
+{
+	struct slrdata_build_worker *w = arg;
+	w->phase(w->job, w->t);
+	return NULL;
+}
+
+// Run one phase on all threads. The parts of a phase are independent, so a
+// part whose thread cannot be started runs on the calling thread.
+static void slrdata_build_phase(struct slrdata_build_job *job, struct slrdata_build_worker *workers, void (*phase)(struct slrdata_build_job *job, unsigned t))
+{
+	bool started[job->threads];
+
+	for(unsigned t = 1; t < job->threads; t++)
+	{
+		workers[t].job = job;
+		workers[t].t = t;
+		workers[t].phase = phase;
+		started[t] = pthread_create(&workers[t].thread, NULL, slrdata_build_thread, &workers[t]) == 0;
+	}
+
+	phase(job, 0);
+
+	for(unsigned t = 1; t < job->threads; t++)
+	{
+		if(started[t])
+			pthread_join(workers[t].thread, NULL);
+		else
+			phase(job, t);
+	}
+}
+
+// Number of threads, at most threads, whose counts per element are worth
+// their memory: every thread gets at least as many incidences as there are
+// elements, and all counts together fit in half the free physical memory.
+static unsigned slrdata_build_threads(unsigned threads, uint_fast64_t element_count, uint_fast64_t incidences)
+{
+	if(element_count == 0)
+		return threads;
+
+	long pages = sysconf(_SC_AVPHYS_PAGES);
+	long page_size = sysconf(_SC_PAGESIZE);
+	uint_fast64_t limit = incidences / element_count;
+	if(pages > 0 && page_size > 0 && (uint_fast64_t)pages * page_size / 2 / sizeof(uint_fast64_t) / element_count < limit)
+		limit = (uint_fast64_t)pages * page_size / 2 / sizeof(uint_fast64_t) / element_count;
+
+	return threads < limit ? threads : (unsigned)limit;
+}
+
+// Same result as slrdata_build_incidence_lists, byte for byte, built by up to
+// the given number of threads. Every thread keeps a count per element, which
+// takes threads * element count * 8 bytes, so the number of threads is
+// lowered until the counts are no larger than the incidences and fit in half
+// the free physical memory. If that leaves one thread, the counts cannot be
+// allocated or the relation is small, the serial build is used.
+int slrdata_build_incidence_lists_parallel(slrdata_t *relation, slrdata_t *elements, uint_fast64_t max_degree, unsigned threads)
+{
+	if(slrdata_fit_columns(relation))
+		return(-1);
+
+	uint_fast64_t element_count = slrdata_element_count(elements);
+	uint_fast64_t arity = slrdata_arity(relation);
+	uint_fast64_t tuple_count = relation->tuple_count;
+
+	if(tuple_count * arity >= SLRDATA_PARALLEL_MIN_INCIDENCES)
+		threads = slrdata_build_threads(threads, element_count, tuple_count * arity);
+
+	if(threads <= 1 || tuple_count * arity < SLRDATA_PARALLEL_MIN_INCIDENCES)
+		return slrdata_build_incidence_lists(relation, elements, max_degree);
+
+	struct slrdata_build_job job;
+	job.counts = calloc(threads * element_count, sizeof(uint_fast64_t));
+	job.chunk_sizes = calloc(threads, sizeof(uint_fast64_t));
+	struct slrdata_build_worker *workers = calloc(threads, sizeof(struct slrdata_build_worker));
+	if(job.counts == NULL || job.chunk_sizes == NULL || workers == NULL)
+	{
+		free(job.counts);
+		free(job.chunk_sizes);
+		free(workers);
+		return slrdata_build_incidence_lists(relation, elements, max_degree);
+	}
+
+	uint_fast64_t tuple_list_offset = slrdata_read(8, relation->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC);
+	uint_fast8_t width = relation->width;
+	uint_fast64_t old_size = relation->size;
+	uint_fast64_t element_list_offset = slrdata_list_align(width, old_size);
+	uint_fast64_t incidence_lists_offset = slrdata_list_align(width, element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + element_count * SLRDATA_RELATION_ELEMENTSIZE);
+	uint_fast64_t new_size = incidence_lists_offset + element_count * slrdata_list_stride(width, 0) + tuple_count * arity * width;
+
+	int ret = -1;
+	if(slrdata_resize(relation, new_size, true))
+		goto done;
+
+	// element list header
+	slrdata_write(6, relation->ptr + element_list_offset, element_count * SLRDATA_RELATION_ELEMENTSIZE);
+	slrdata_write(6, relation->ptr + element_list_offset + 6, element_count);
+
+	job.ptr = relation->ptr;
+	job.tuple_list = relation->ptr + tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE;
+	job.element_list = relation->ptr + element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE;
+	job.width = width;
+	job.column_stride = relation->column_stride;
+	job.arity = arity;
+	job.tuple_count = tuple_count;
+	job.element_count = element_count;
+	job.max_degree = max_degree;
+	job.incidence_lists_offset = incidence_lists_offset;
+	job.threads = threads;
+	job.failed = false;
+
+	slrdata_build_phase(&job, workers, slrdata_build_count);
+	if(!job.failed)
+		slrdata_build_phase(&job, workers, slrdata_build_merge);
+	if(!job.failed)
+	{
+		slrdata_build_phase(&job, workers, slrdata_build_layout);
+		slrdata_build_phase(&job, workers, slrdata_build_scatter);
+		ret = 0;
+	}
+
+	if(ret == 0)
+	{
+		for(unsigned t = 0; t < threads; t++)
+			incidence_lists_offset += job.chunk_sizes[t];
+
+		// update element list offset
+		slrdata_write(8, relation->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 8, element_list_offset);
+		if(slrdata_resize(relation, incidence_lists_offset, true))
+			ret = -1;
+		else
+			ret = slrdata_trim(relation);
+	}
+	else
+	{
+		slrdata_resize(relation, old_size, true);
+		slrdata_trim(relation);
+	}
+
+done:
+	free(job.counts);
+	free(job.chunk_sizes);
+	free(workers);
+
+	return(ret);
+}
+
+static const unsigned char * slrdata_incidence_list(slrdata_t *relation, uint_fast64_t e)
+{
+	return relation->ptr + slrdata_read(8, relation->element_list + (e * SLRDATA_RELATION_ELEMENTSIZE));
+}
+
+// Encode the incidence list of an uncompressed relation as the body of a
+// compressed list at dst, or only measure it if dst is NULL. Returns the size
+// of the body, or -1 if the list is not in tuple index order.
+static uint_fast64_t slrdata_compress_list(slrdata_t *relation, const unsigned char *incidence_list, unsigned char *dst)
+{
+	uint_fast64_t degree = slrdata_read(6, incidence_list + 6);
+	uint_fast64_t block_count = (degree + SLRDATA_CODEC_BLOCK - 1) / SLRDATA_CODEC_BLOCK;
+	uint_fast64_t skip_size = block_count ? (block_count - 1) * SLRDATA_CODEC_SKIPENTRYSIZE : 0;
+	uint_fast64_t size = skip_size;
+	uint64_t block[SLRDATA_CODEC_BLOCK];
+	uint64_t last = 0;
+
+	for (uint_fast64_t k = 0; k < block_count; k++)
+	{
+		uint_fast64_t first = k * SLRDATA_CODEC_BLOCK;
+		uint_fast64_t n = degree - first < SLRDATA_CODEC_BLOCK ? degree - first : SLRDATA_CODEC_BLOCK;
+		slrdata_decode(relation->width, incidence_list + SLRDATA_RELATION_LISTHEADERSIZE + first * relation->width, block, n);
+
+		for (uint_fast64_t j = 0; j < n; j++)
+		{
+			if (block[j] < last)
+				return -1;
+			last = block[j];
+		}
+
+		if (dst && k)
+		{
+			slrdata_write(6, dst + (k - 1) * SLRDATA_CODEC_SKIPENTRYSIZE, block[0]);
+			slrdata_write(6, dst + (k - 1) * SLRDATA_CODEC_SKIPENTRYSIZE + 6, size - skip_size);
+		}
+
+		size += slrdata_encode_block(dst ? dst + size : NULL, block, n);
+	}
+
+	return size;
+}
+
+// Size of the body of the incidence list in a copy of the relation, compressed
+// if encode is set. Returns -1 if the list cannot be compressed.
+static uint_fast64_t slrdata_copy_list_size(slrdata_t *rel, const unsigned char *incidence_list, bool encode)
+{
+	if(rel->compressed)
+		return slrdata_read(6, incidence_list);
+	if(encode)
+		return slrdata_compress_list(rel, incidence_list, NULL);
+
+	return slrdata_read(6, incidence_list + 6) * rel->width;
+}
+
+// Copy the relation to a new file without the unused space between incidence
+// lists, compressing them if compress is set. The incidence lists are measured
+// first so that the file is resized once, runs of lists that keep their
+// layout are copied with one memcpy, and the copy atomically replaces the
+// file under its old name. The handle is moved to the new file.
+static int slrdata_copy_relation(slrdata_t *rel, bool compress)
+{
+	slrdata_t rel_new;
+	char *copyname = malloc(strlen(rel->filename) + 5);
+	if(copyname == NULL)
+		return -1;
+	strcat(strcpy(copyname, rel->filename), "copy");
+
+	// keep the version and field width, version 1 files gain a section list
+	if(slrdata_create_relation(&rel_new, (const char *restrict)rel->foldername, copyname, rel->version >= 2 ? rel->version : 2, rel->width, rel->columnar ? SLRDATA_LAYOUT_COLUMNAR : 0))
+	{
+		free(copyname);
+		return -1;
+	}
+	char *copypath = slrdata_filepath(rel_new.foldername, copyname);
+
+	uint_fast8_t width = rel->width;
+	uint_fast64_t tuple_count = rel->tuple_count;
+	uint_fast64_t arity = slrdata_arity(rel);
+	// columns may have room left for more tuples, the list size covers it
+	uint_fast64_t tuple_list_size = SLRDATA_RELATION_LISTHEADERSIZE + (rel->tuple_list ? slrdata_read(6, rel->tuple_list - SLRDATA_RELATION_LISTHEADERSIZE) : tuple_count * (arity * width));
+	uint_fast64_t element_count = slrdata_element_count(rel);
+	uint_fast64_t element_list_size = SLRDATA_RELATION_LISTHEADERSIZE + (element_count * SLRDATA_RELATION_ELEMENTSIZE);
+	bool encode = compress && !rel->compressed;
+	compress = compress || rel->compressed;
+	uint_fast64_t new_tuple_list_offset = slrdata_list_align(width, rel_new.size);
+	uint_fast64_t new_element_list_offset = slrdata_list_align(width, new_tuple_list_offset + tuple_list_size);
+	uint_fast64_t new_incidence_lists_offset = slrdata_list_align(width, new_element_list_offset + element_list_size);
+
+	uint_fast64_t incidence_lists_size = 0;
+	for(uint_fast64_t i = 0; i < element_count; i++)
+	{
+		uint_fast64_t list_size = slrdata_copy_list_size(rel, slrdata_incidence_list(rel, i), encode);
+		if(list_size == (uint_fast64_t)-1)
+			goto fail;
+		incidence_lists_size += compress ? SLRDATA_RELATION_LISTHEADERSIZE + list_size : slrdata_list_stride(width, list_size);
+	}
+
+	// resize
+	if(slrdata_resize(&rel_new, new_incidence_lists_offset + incidence_lists_size, true))
+		goto fail;
+
+	// update arity
+	slrdata_write(6, rel_new.ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 16, arity);
+
+	// copy tuple list, a relation without one gets an empty one
+	uint_fast64_t old_tuple_list_offset = slrdata_read(8, rel->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC);
+	slrdata_write(8, rel_new.ptr + SLRDATA_RELATION_HEADERSIZE_BASIC, new_tuple_list_offset);
+	if(old_tuple_list_offset)
+	{
+		memcpy(rel_new.ptr + new_tuple_list_offset, rel->ptr + old_tuple_list_offset, tuple_list_size);
+	}
+	else
+	{
+		slrdata_write(6, rel_new.ptr + new_tuple_list_offset, 0);
+		slrdata_write(6, rel_new.ptr + new_tuple_list_offset + 6, 0);
+	}
+
+	// add element list offset
+	slrdata_write(8, rel_new.ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 8, new_element_list_offset);
+
+	// copy element list header
+	slrdata_write(6, rel_new.ptr + new_element_list_offset, element_count * SLRDATA_RELATION_ELEMENTSIZE);
+	slrdata_write(6, rel_new.ptr + new_element_list_offset + 6, element_count);
+
+	// copy incidence lists. Lists without unused space that keep their
+	// distance to the start of the run are copied along with it.
+	uint_fast64_t current_offset = new_incidence_lists_offset;
+	uint_fast64_t run_source = 0, run_target = 0, run_length = 0;
+	for(uint_fast64_t i = 0; i < element_count; i++)
+	{
+		const unsigned char *old_incidence_list = slrdata_incidence_list(rel, i);
+		uint_fast64_t old_incidence_list_offset = old_incidence_list - rel->ptr;
+		uint_fast64_t list_size = slrdata_copy_list_size(rel, old_incidence_list, encode);
+		// compressed lists are packed one after another
+		uint_fast64_t stride = compress ? SLRDATA_RELATION_LISTHEADERSIZE + list_size : slrdata_list_stride(width, list_size);
+
+		// update incidence list offset
+		slrdata_write(8, rel_new.ptr + new_element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (i * SLRDATA_RELATION_ELEMENTSIZE), current_offset);
+
+		bool verbatim = !encode && slrdata_read(6, old_incidence_list) == list_size;
+		if(run_length && (!verbatim || old_incidence_list_offset - run_source != current_offset - run_target))
+		{
+			memcpy(rel_new.ptr + run_target, rel->ptr + run_source, run_length);
+			run_length = 0;
+		}
+
+		if(verbatim)
+		{
+			if(run_length == 0)
+			{
+				run_source = old_incidence_list_offset;
+				run_target = current_offset;
+			}
+			run_length = old_incidence_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + list_size - run_source;
+		}
+		else
+		{
+			slrdata_write(6, rel_new.ptr + current_offset, list_size);
+			slrdata_write(6, rel_new.ptr + current_offset + 6, slrdata_read(6, old_incidence_list + 6));
+
+			if(encode)
+				slrdata_compress_list(rel, old_incidence_list, rel_new.ptr + current_offset + 12);
+			else
+				memcpy(rel_new.ptr + current_offset + 12, old_incidence_list + 12, list_size);
+		}
+
+		current_offset += stride;
+	}
+
+	if(run_length)
+		memcpy(rel_new.ptr + run_target, rel->ptr + run_source, run_length);
+
+	// copy sections
+	uint_fast64_t section_list_offset = slrdata_section_list_field(rel) ? slrdata_read(8, rel->ptr + slrdata_section_list_field(rel)) : 0;
+	uint_fast64_t section_count = section_list_offset ? slrdata_read(6, rel->ptr + section_list_offset + 6) : 0;
+	for(uint_fast64_t i = 0; i < section_count; i++)
+	{
+		const unsigned char *entry = rel->ptr + section_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (i * SLRDATA_SECTIONENTRYSIZE);
+		char tag[SLRDATA_SECTIONTAGSIZE + 1] = { 0 };
+		memcpy(tag, entry, SLRDATA_SECTIONTAGSIZE);
+		uint_fast64_t section_size = slrdata_read(8, entry + SLRDATA_SECTIONTAGSIZE + 8);
+
+		uint_fast64_t section_offset = slrdata_add_section(&rel_new, tag, section_size);
+		if(section_offset == 0)
+			goto fail;
+
+		memcpy(rel_new.ptr + section_offset, rel->ptr + slrdata_read(8, entry + SLRDATA_SECTIONTAGSIZE), section_size);
+	}
+
+	if(encode)
+	{
+		uint_fast64_t codec_offset = slrdata_add_section(&rel_new, "inccodec", 8);
+		if(codec_offset == 0)
+			goto fail;
+
+		slrdata_write(8, rel_new.ptr + codec_offset, SLRDATA_CODEC_DELTA);
+		slrdata_refresh(&rel_new);
+	}
+
+	if(slrdata_trim(&rel_new))
+		goto fail;
+
+	// rename replaces the old file in one step
+	char *path = slrdata_filepath(rel->foldername, rel->filename);
+	int renamed = rename(copypath, path);
+	free(path);
+	if(renamed)
+		goto fail;
+
+	// the handle follows the file to its old name
+	memcpy(rel_new.rng, rel->rng, sizeof(rel->rng));
+	rel_new.filename = rel->filename;
+	unsigned hints = rel->hints;
+	rel_new.stats = rel->stats;
+	rel->stats = NULL;
+	slrdata_close(rel);
+	*rel = rel_new;
+	slrdata_advise(rel, hints);
+	free(copypath);
+	free(copyname);
+
+	return 0;
+
+fail:
+	slrdata_close(&rel_new);
+	unlink(copypath);
+	free(copypath);
+	free(copyname);
+
+	return -1;
+}
+
+// Slide the incidence lists toward the front of the file, dropping the unused
+// space in and between them, then move the sections after them down. Every
+// list only moves toward the front, so the file is compacted in place without
+// a second copy; runs of lists without unused space move with one memmove.
+// Returns 1 if the lists are not in element order or sections lie between
+// them.
+static int slrdata_compact(slrdata_t *rel)
+{
+	if(rel->element_list == NULL)
+		return slrdata_fit_columns(rel) || slrdata_trim(rel) ? -1 : 0;
+
+	uint_fast8_t width = rel->width;
+	uint_fast64_t element_list_offset = slrdata_read(8, rel->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 8);
+	uint_fast64_t incidence_lists_offset = slrdata_list_align(width, element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + rel->element_count * SLRDATA_RELATION_ELEMENTSIZE);
+
+	// end of the last incidence list
+	uint_fast64_t end = incidence_lists_offset;
+	for(uint_fast64_t e = 0; e < rel->element_count; e++)
+	{
+		uint_fast64_t offset = slrdata_read(8, rel->element_list + e * SLRDATA_RELATION_ELEMENTSIZE);
+		if(offset < end)
+			return 1;
+		end = offset + SLRDATA_RELATION_LISTHEADERSIZE + slrdata_read(6, rel->ptr + offset);
+	}
+
+	uint_fast64_t field = slrdata_section_list_field(rel);
+	uint_fast64_t section_list_offset = field ? slrdata_read(8, rel->ptr + field) : 0;
+	uint_fast64_t section_count = section_list_offset ? slrdata_read(6, rel->ptr + section_list_offset + 6) : 0;
+	if(section_list_offset >= incidence_lists_offset && section_list_offset < end)
+		return 1;
+	for(uint_fast64_t i = 0; i < section_count; i++)
+	{
+		uint_fast64_t offset = slrdata_read(8, rel->ptr + section_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + i * SLRDATA_SECTIONENTRYSIZE + SLRDATA_SECTIONTAGSIZE);
+		if(offset >= incidence_lists_offset && offset < end)
+			return 1;
+	}
+
+	uint_fast64_t current_offset = incidence_lists_offset, new_end = incidence_lists_offset;
+	uint_fast64_t run_source = 0, run_target = 0, run_length = 0;
+	for(uint_fast64_t e = 0; e < rel->element_count; e++)
+	{
+		uint_fast64_t offset = slrdata_read(8, rel->element_list + e * SLRDATA_RELATION_ELEMENTSIZE);
+		uint_fast64_t old_size = slrdata_read(6, rel->ptr + offset);
+		uint_fast64_t list_size = rel->compressed ? old_size : slrdata_read(6, rel->ptr + offset + 6) * width;
+		uint_fast64_t stride = rel->compressed ? SLRDATA_RELATION_LISTHEADERSIZE + list_size : slrdata_list_stride(width, list_size);
+
+		slrdata_write(8, rel->element_list + e * SLRDATA_RELATION_ELEMENTSIZE, current_offset);
+
+		bool verbatim = old_size == list_size;
+		if(run_length && (!verbatim || offset - run_source != current_offset - run_target))
+		{
+			memmove(rel->ptr + run_target, rel->ptr + run_source, run_length);
+			run_length = 0;
+		}
+
+		if(verbatim)
+		{
+			if(run_length == 0)
+			{
+				run_source = offset;
+				run_target = current_offset;
+			}
+			run_length = offset + SLRDATA_RELATION_LISTHEADERSIZE + list_size - run_source;
+		}
+		else
+		{
+			memmove(rel->ptr + current_offset, rel->ptr + offset, SLRDATA_RELATION_LISTHEADERSIZE + list_size);
+			slrdata_write(6, rel->ptr + current_offset, list_size);
+		}
+
+		new_end = current_offset + SLRDATA_RELATION_LISTHEADERSIZE + list_size;
+		current_offset += stride;
+	}
+
+	if(run_length)
+		memmove(rel->ptr + run_target, rel->ptr + run_source, run_length);
+
+	// move the sections after the incidence lists by a multiple of 8, so that
+	// they stay aligned
+	uint_fast64_t new_size = new_end;
+	if(end < rel->size)
+	{
+		uint_fast64_t tail_offset = new_end + ((end - new_end) & 7);
+		uint_fast64_t shift = end - tail_offset;
+		memmove(rel->ptr + tail_offset, rel->ptr + end, rel->size - end);
+		new_size = rel->size - shift;
+
+		if(section_list_offset >= end)
+		{
+			section_list_offset -= shift;
+			slrdata_write(8, rel->ptr + field, section_list_offset);
+		}
+		for(uint_fast64_t i = 0; i < section_count; i++)
+		{
+			unsigned char *entry = rel->ptr + section_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + i * SLRDATA_SECTIONENTRYSIZE + SLRDATA_SECTIONTAGSIZE;
+			if(slrdata_read(8, entry) >= end)
+				slrdata_write(8, entry, slrdata_read(8, entry) - shift);
+		}
+	}
+
+	if(slrdata_resize(rel, new_size, true))
+		return -1;
+
+	return slrdata_trim(rel);
+}
+
+// Reduce size by removing unneeded space between incidence lists. The file is
+// compacted in place if its lists are in element order, as they are after all
+// functions that build them, and copied otherwise.
+int slrdata_reduce_size(slrdata_t *rel)
+{
+	if(rel->readonly)
+		return -1;
+
+	int ret = slrdata_compact(rel);
+	if(ret == 1)
+		return slrdata_copy_relation(rel, false);
+
+	return ret;
+}
+
+// Rewrite the relation with compressed incidence lists: the tuple indices of
+// every list are delta encoded in blocks of SLRDATA_CODEC_BLOCK, each with its
+// own bit width, after a skip index of the blocks. The degree stays in the
+// list header, and the i-th incidence is read by decoding a single block. The
+// incidence lists must be in tuple index order, so the relation cannot have
+// been sorted by slrdata_sort_incidence_lists. Later copies by
+// slrdata_reduce_size keep the lists compressed.
+int slrdata_compress_incidence_lists(slrdata_t *rel)
+{
+	if(rel->element_list == NULL || rel->sorted)
+		return -1;
+
+	return slrdata_copy_relation(rel, true);
+}
+
+uint_fast64_t slrdata_arity(slrdata_t *relation)
+{
+	return relation->arity;
+}
+
+// degree of e in the incidence lists, without the delta segment
+static uint_fast64_t slrdata_base_degree(slrdata_t *relation, uint_fast64_t e)
+{
+	if (e >= relation->element_count)
+		return 0;
+
+	return slrdata_read(6, slrdata_incidence_list(relation, e) + 6);
+}
+
+// The delta segment ("tupdelta" section) holds the tuple count and the
+// incidence count, the tuples as arity 8 byte fields each, and one (element,
+// tuple index) pair of 8 byte fields per incidence, sorted. Its tuples follow
+// the tuple list, so their indices start at the tuple count of the base.
+#define SLRDATA_DELTA_HEADERSIZE 16
+#define SLRDATA_DELTA_INCIDENCESIZE 16
+
+static inline const unsigned char * slrdata_delta_tuple(slrdata_t *relation, uint_fast64_t j)
+{
+	return relation->delta + SLRDATA_DELTA_HEADERSIZE + j * relation->arity * 8;
+}
+
+static inline const unsigned char * slrdata_delta_incidences(slrdata_t *relation)
+{
+	return slrdata_delta_tuple(relation, relation->delta_count);
+}
+
+static inline uint_fast64_t slrdata_delta_incidence_count(slrdata_t *relation)
+{
+	return relation->delta ? slrdata_read(8, relation->delta + 8) : 0;
+}
+
+// Number of incidences of e in the delta segment, the first of them is left in
+// first
+static uint_fast64_t slrdata_delta_range(slrdata_t *relation, uint_fast64_t e, uint_fast64_t *first)
+{
+	if (relation->delta == NULL)
+	{
+		*first = 0;
+		return 0;
+	}
+
+	const unsigned char *incidences = slrdata_delta_incidences(relation);
+	uint_fast64_t count = slrdata_delta_incidence_count(relation);
+	uint_fast64_t lo = 0, hi = count;
+	while (lo < hi)
+	{
+		uint_fast64_t mid = lo + (hi - lo) / 2;
+		if (slrdata_read(8, incidences + mid * SLRDATA_DELTA_INCIDENCESIZE) < e)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	*first = lo;
+	for (hi = count; lo < hi;)
+	{
+		uint_fast64_t mid = lo + (hi - lo) / 2;
+		if (slrdata_read(8, incidences + mid * SLRDATA_DELTA_INCIDENCESIZE) <= e)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo - *first;
+}
+
+// tuple index of delta incidence i
+static inline uint_fast64_t slrdata_delta_incidence(slrdata_t *relation, uint_fast64_t i)
+{
+	return slrdata_read(8, slrdata_delta_incidences(relation) + i * SLRDATA_DELTA_INCIDENCESIZE + 8);
+}
+
+// Decode the tuple with index i, from the tuple list or the delta segment
+static inline void slrdata_load_tuple(slrdata_t *relation, uint_fast64_t i, uint_fast64_t *tuple)
+{
+	if (i < relation->tuple_count)
+	{
+		slrdata_decode_tuple(relation->width, relation->tuple_list, relation->arity, relation->column_stride, i, tuple);
+		return;
+	}
+
+	const unsigned char *ptr = slrdata_delta_tuple(relation, i - relation->tuple_count);
+	for (uint_fast64_t j = 0; j < relation->arity; j++)
+		tuple[j] = slrdata_read(8, ptr + j * 8);
+}
+
+// Degree of e, including the tuples in the delta segment
+static inline uint_fast64_t slrdata_total_degree(slrdata_t *relation, uint_fast64_t e)
+{
+	uint_fast64_t first;
+	uint_fast64_t degree = slrdata_base_degree(relation, e);
+
+	// most relations never had a delta segment
+	if (relation->delta == NULL)
+		return degree;
+
+	return degree + slrdata_delta_range(relation, e, &first);
+}
+
+uint_fast64_t slrdata_degree(slrdata_t *relation, uint_fast64_t e)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_DEGREE, 1);
+
+	return slrdata_total_degree(relation, e);
+}
+
+// Block k of a compressed incidence list of the given degree, body is the list
+// after its header
+static const unsigned char * slrdata_incidence_block(const unsigned char *body, uint_fast64_t degree, uint_fast64_t k)
+{
+	uint_fast64_t block_count = (degree + SLRDATA_CODEC_BLOCK - 1) / SLRDATA_CODEC_BLOCK;
+	const unsigned char *blocks = body + (block_count - 1) * SLRDATA_CODEC_SKIPENTRYSIZE;
+
+	return k ? blocks + slrdata_read(6, body + (k - 1) * SLRDATA_CODEC_SKIPENTRYSIZE + 6) : blocks;
+}
+
+// Number of tuple indices in block k of an incidence list of the given degree
+static inline uint_fast64_t slrdata_incidence_block_size(uint_fast64_t degree, uint_fast64_t k)
+{
+	uint_fast64_t first = k * SLRDATA_CODEC_BLOCK;
+
+	return degree - first < SLRDATA_CODEC_BLOCK ? degree - first : SLRDATA_CODEC_BLOCK;
+}
+
+// Tuple index at position i of the incidence list, i below its degree. Decodes
+// at most the block holding i if the list is compressed.
+static uint_fast64_t slrdata_incidence(slrdata_t *relation, const unsigned char *incidence_list, uint_fast64_t i)
+{
+	const unsigned char *body = incidence_list + SLRDATA_RELATION_LISTHEADERSIZE;
+
+	if (!relation->compressed)
+		return slrdata_get(relation->width, body, i);
+
+	uint_fast64_t degree = slrdata_read(6, incidence_list + 6);
+	uint_fast64_t k = i / SLRDATA_CODEC_BLOCK;
+	const unsigned char *block = slrdata_incidence_block(body, degree, k);
+	uint_fast8_t bits = block[0];
+	uint_fast64_t v;
+	const unsigned char *packed = block + 1 + slrdata_varint_read(block + 1, &v);
+	uint_fast64_t packed_size = slrdata_packed_size(slrdata_incidence_block_size(degree, k) - 1, bits);
+
+	for (uint_fast64_t j = 0; j < i % SLRDATA_CODEC_BLOCK; j++)
+		v += slrdata_unpack(packed, packed_size, bits, j);
+
+	return v;
+}
+
+// Decode n tuple indices of the incidence list starting at position first
+static void slrdata_decode_incidences(slrdata_t *relation, const unsigned char *incidence_list, uint_fast64_t first, uint_fast64_t n, uint64_t *indices)
+{
+	const unsigned char *body = incidence_list + SLRDATA_RELATION_LISTHEADERSIZE;
+
+	if (!relation->compressed)
+	{
+		slrdata_decode(relation->width, body + first * relation->width, indices, n);
+		return;
+	}
+
+	if (n == 0)
+		return;
+
+	// blocks follow each other, so only the first one is looked up
+	uint_fast64_t degree = slrdata_read(6, incidence_list + 6);
+	uint_fast64_t k = first / SLRDATA_CODEC_BLOCK;
+	const unsigned char *block = slrdata_incidence_block(body, degree, k);
+	uint64_t decoded[SLRDATA_CODEC_BLOCK];
+
+	for (; n; k++)
+	{
+		uint_fast64_t skip = first - k * SLRDATA_CODEC_BLOCK;
+		uint_fast64_t size = slrdata_incidence_block_size(degree, k);
+		uint_fast64_t m = size - skip < n ? size - skip : n;
+
+		block += slrdata_decode_block(block, size, decoded);
+		memcpy(indices, decoded + skip, m * sizeof(uint64_t));
+		indices += m;
+		first += m;
+		n -= m;
+	}
+}
+
+// Whether tuple index t is in the compressed incidence list. The skip index is
+// binary searched for the block that may hold it.
+static bool slrdata_has_incidence(const unsigned char *incidence_list, uint_fast64_t t)
+{
+	const unsigned char *body = incidence_list + SLRDATA_RELATION_LISTHEADERSIZE;
+	uint_fast64_t degree = slrdata_read(6, incidence_list + 6);
+
+	if (degree == 0)
+		return false;
+
+	uint_fast64_t lo = 0, hi = (degree - 1) / SLRDATA_CODEC_BLOCK;
+	while (lo < hi)
+	{
+		uint_fast64_t mid = hi - (hi - lo) / 2;
+		if (slrdata_read(6, body + (mid - 1) * SLRDATA_CODEC_SKIPENTRYSIZE) <= t)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	uint64_t decoded[SLRDATA_CODEC_BLOCK];
+	uint_fast64_t size = slrdata_incidence_block_size(degree, lo);
+	slrdata_decode_block(slrdata_incidence_block(body, degree, lo), size, decoded);
+
+	for (uint_fast64_t j = 0; j < size && decoded[j] <= t; j++)
+		if (decoded[j] == t)
+			return true;
+
+	return false;
+}
+
+// Tuple index at position i of the incidences of e, the incidence list
+// followed by the delta segment, or -1 if e has no more incidences
+static uint_fast64_t slrdata_incidence_at(slrdata_t *relation, uint_fast64_t e, uint_fast64_t i)
+{
+	uint_fast64_t degree = slrdata_base_degree(relation, e);
+	if (i < degree)
+		return slrdata_incidence(relation, slrdata_incidence_list(relation, e), i);
+
+	uint_fast64_t first;
+	if (i - degree >= slrdata_delta_range(relation, e, &first))
+		return -1;
+
+	return slrdata_delta_incidence(relation, first + i - degree);
+}
+
+// i and e start at 0. Decodes the tuple into the arity entries of tuple.
+int slrdata_read_tuple(slrdata_t *relation, uint_fast64_t e, uint_fast64_t i, uint_fast64_t *tuple)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_TUPLE, 1);
+	uint_fast64_t tuple_index = slrdata_incidence_at(relation, e, i);
+
+	if (tuple_index == (uint_fast64_t)-1)
+	{
+		return(-1);
+	}
+
+	slrdata_load_tuple(relation, tuple_index, tuple);
+
+	return(0);
+}
+
+// i starts at 0. Decodes the tuple into the arity entries of tuple.
+int slrdata_read_ith_tuple(slrdata_t *relation, uint_fast64_t i, uint_fast64_t *tuple)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_ITH_TUPLE, 1);
+	if (relation->tuple_count + relation->delta_count <= i)
+	{
+		return(-1);
+	}
+
+	slrdata_load_tuple(relation, i, tuple);
+
+	return(0);
+}
+
+// TODO rename. i and e start at 0. The returned tuple must be freed by the caller.
+uint_fast64_t * slrdata_tuple(slrdata_t *relation, uint_fast64_t e, uint_fast64_t i)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_TUPLE, 1);
+	uint_fast64_t tuple_index = slrdata_incidence_at(relation, e, i);
+
+	if (tuple_index == (uint_fast64_t)-1)
+	{
+		return NULL;
+	}
+
+	uint_fast64_t *tuple = (uint_fast64_t*)malloc(relation->arity * sizeof(uint_fast64_t));
+	slrdata_load_tuple(relation, tuple_index, tuple);
+
+	return tuple;
+}
+
+// The returned tuple must be freed by the caller.
+uint_fast64_t * slrdata_ith_tuple(slrdata_t *relation, uint_fast64_t i)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_ITH_TUPLE, 1);
+	if (relation->tuple_count + relation->delta_count <= i)
+	{
+		return NULL;
+	}
+
+	uint_fast64_t *tuple = (uint_fast64_t*)malloc(relation->arity * sizeof(uint_fast64_t));
+	slrdata_load_tuple(relation, i, tuple);
+
+	return tuple;
+}
+
+// Start loading the tuple with index i into the cache
+static inline void slrdata_prefetch_tuple(slrdata_t *relation, uint_fast64_t i)
+{
+	if (i >= relation->tuple_count)
+		return;
+
+	uint_fast8_t width = relation->width;
+	if (relation->column_stride)
+	{
+		for (uint_fast64_t j = 0; j < relation->arity; j++)
+			__builtin_prefetch(relation->tuple_list + (j * relation->column_stride + i) * width);
+		return;
+	}
+
+	// a row may straddle two cache lines
+	const unsigned char *ptr = relation->tuple_list + i * relation->arity * width;
+	__builtin_prefetch(ptr);
+	__builtin_prefetch(ptr + relation->arity * width - 1);
+}
+
+// Start loading the offset of the incidence list of e
+static inline void slrdata_prefetch_element(slrdata_t *relation, uint_fast64_t e)
+{
+	if (e < relation->element_count)
+		__builtin_prefetch(relation->element_list + e * SLRDATA_RELATION_ELEMENTSIZE);
+}
+
+// Start loading the header of the incidence list of e and, for uncompressed
+// lists, its i-th entry. The offset of the list should be cached already.
+static inline void slrdata_prefetch_incidence(slrdata_t *relation, uint_fast64_t e, uint_fast64_t i)
+{
+	if (e >= relation->element_count)
+		return;
+
+	const unsigned char *incidence_list = slrdata_incidence_list(relation, e);
+	__builtin_prefetch(incidence_list);
+	if (!relation->compressed)
+		__builtin_prefetch(incidence_list + SLRDATA_RELATION_LISTHEADERSIZE + i * relation->width);
+}
+
+// Read the i-th tuples of n elements in stages, each starting the loads the
+// next one needs for all of them, so that the element list, incidence list
+// and tuple list misses of the requests overlap
+static int slrdata_read_tuple_group(slrdata_t *relation, const uint_fast64_t *elements, const uint_fast64_t *indices, uint_fast64_t n, uint_fast64_t *tuples)
+{
+	uint_fast64_t tuple_index[SLRDATA_PREFETCH_GROUP];
+	int ret = 0;
+
+	for (uint_fast64_t j = 0; j < n; j++)
+		slrdata_prefetch_element(relation, elements[j]);
+
+	for (uint_fast64_t j = 0; j < n; j++)
+		slrdata_prefetch_incidence(relation, elements[j], indices[j]);
+
+	for (uint_fast64_t j = 0; j < n; j++)
+	{
+		tuple_index[j] = slrdata_incidence_at(relation, elements[j], indices[j]);
+		slrdata_prefetch_tuple(relation, tuple_index[j]);
+	}
+
+	for (uint_fast64_t j = 0; j < n; j++, tuples += relation->arity)
+	{
+		if (tuple_index[j] == (uint_fast64_t)-1)
+		{
+			for (uint_fast64_t a = 0; a < relation->arity; a++)
+				tuples[a] = -1;
+			ret = -1;
+			continue;
+		}
+
+		slrdata_load_tuple(relation, tuple_index[j], tuples);
+	}
+
+	return(ret);
+}
+
+// Batched slrdata_read_tuple: the indices[j]-th tuple of elements[j] is
+// written to tuples + j * arity. The requests are processed in groups whose
+// cache misses overlap instead of waiting on three dependent misses per
+// request. Requests that are out of range get tuples of -1 and make the call
+// return -1.
+int slrdata_read_tuples(slrdata_t *relation, const uint_fast64_t *elements, const uint_fast64_t *indices, uint_fast64_t count, uint_fast64_t *tuples)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_BATCH, count);
+	int ret = 0;
+
+	for (uint_fast64_t start = 0; start < count; start += SLRDATA_PREFETCH_GROUP)
+	{
+		uint_fast64_t n = count - start < SLRDATA_PREFETCH_GROUP ? count - start : SLRDATA_PREFETCH_GROUP;
+		if (slrdata_read_tuple_group(relation, elements + start, indices + start, n, tuples + start * relation->arity))
+			ret = -1;
+	}
+
+	return(ret);
+}
+
+// Batched slrdata_read_ith_tuple, the tuples are prefetched a group ahead of
+// the one being read. Indices out of range get tuples of -1 and make the call
+// return -1.
+int slrdata_read_ith_tuples(slrdata_t *relation, const uint_fast64_t *indices, uint_fast64_t count, uint_fast64_t *tuples)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_BATCH, count);
+	uint_fast64_t tuple_count = relation->tuple_count + relation->delta_count;
+	int ret = 0;
+
+	for (uint_fast64_t j = 0; j < count && j < SLRDATA_PREFETCH_GROUP; j++)
+		slrdata_prefetch_tuple(relation, indices[j]);
+
+	for (uint_fast64_t j = 0; j < count; j++, tuples += relation->arity)
+	{
+		if (j + SLRDATA_PREFETCH_GROUP < count)
+			slrdata_prefetch_tuple(relation, indices[j + SLRDATA_PREFETCH_GROUP]);
+
+		if (indices[j] >= tuple_count)
+		{
+			for (uint_fast64_t a = 0; a < relation->arity; a++)
+				tuples[a] = -1;
+			ret = -1;
+			continue;
+		}
+
+		slrdata_load_tuple(relation, indices[j], tuples);
+	}
+
+	return(ret);
+}
+
+// Batched slrdata_degree
+void slrdata_degrees(slrdata_t *relation, const uint_fast64_t *elements, uint_fast64_t count, uint_fast64_t *degrees)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_BATCH, count);
+	for (uint_fast64_t start = 0; start < count; start += SLRDATA_PREFETCH_GROUP)
+	{
+		uint_fast64_t n = count - start < SLRDATA_PREFETCH_GROUP ? count - start : SLRDATA_PREFETCH_GROUP;
+
+		for (uint_fast64_t j = start; j < start + n; j++)
+			slrdata_prefetch_element(relation, elements[j]);
+
+		for (uint_fast64_t j = start; j < start + n; j++)
+			if (elements[j] < relation->element_count)
+				__builtin_prefetch(slrdata_incidence_list(relation, elements[j]));
+
+		for (uint_fast64_t j = start; j < start + n; j++)
+			degrees[j] = slrdata_total_degree(relation, elements[j]);
+	}
+}
+
+// Cursor over all tuples of the relation, in tuple list order
+void slrdata_tuple_cursor(slrdata_t *relation, slrdata_cursor_t *c)
+{
+	c->width = relation->width;
+	c->column_stride = relation->column_stride;
+	c->arity = relation->arity;
+	c->tuple_list = relation->tuple_list;
+	c->position = NULL;
+	c->end = NULL;
+	c->next = 0;
+	c->index = 0;
+	c->count = relation->tuple_count;
+	c->compressed = false;
+	c->left = 0;
+	c->delta_tuples = relation->delta_count ? slrdata_delta_tuple(relation, 0) : NULL;
+	c->delta_incidences = NULL;
+	c->delta_first = relation->tuple_count;
+	c->delta_next = 0;
+	c->delta_count = relation->delta_count;
+}
+
+// Cursor over the tuples incident to element e, in incidence list order
+void slrdata_incidence_cursor(slrdata_t *relation, uint_fast64_t e, slrdata_cursor_t *c)
+{
+	uint_fast64_t degree = slrdata_base_degree(relation, e);
+	// elements added after the incidence lists were built have none
+	const unsigned char *incidence_list = e < relation->element_count ? slrdata_incidence_list(relation, e) : relation->ptr;
+
+	slrdata_tuple_cursor(relation, c);
+	c->position = incidence_list + SLRDATA_RELATION_LISTHEADERSIZE;
+	c->end = c->position + degree * c->width;
+	c->count = degree;
+
+	uint_fast64_t first;
+	c->delta_count = slrdata_delta_range(relation, e, &first);
+	if (c->delta_count)
+		c->delta_incidences = slrdata_delta_incidences(relation) + first * SLRDATA_DELTA_INCIDENCESIZE;
+
+	// blocks are read one after another, the skip index is passed over
+	if (relation->compressed && degree)
+	{
+		c->compressed = true;
+		c->position = slrdata_incidence_block(c->position, degree, 0);
+		c->end = NULL;
+	}
+}
+
+// Index of the next tuple of the tuple list or incidence list, false once they
+// are exhausted
+static bool slrdata_cursor_step(slrdata_cursor_t *c, uint_fast64_t *index)
+{
+	uint_fast64_t tuple_index;
+
+	if (c->compressed)
+	{
+		if (c->next == c->count)
+			return false;
+
+		if (c->left == 0)
+		{
+			// start the next block
+			uint_fast64_t size = c->count - c->next < SLRDATA_CODEC_BLOCK ? c->count - c->next : SLRDATA_CODEC_BLOCK;
+			c->bits = c->position[0];
+			c->packed = c->position + 1 + slrdata_varint_read(c->position + 1, &c->value);
+			c->packed_size = slrdata_packed_size(size - 1, c->bits);
+			c->position = c->packed + c->packed_size;
+			c->left = size - 1;
+		}
+		else
+		{
+			c->value += slrdata_unpack(c->packed, c->packed_size, c->bits, (c->next - 1) % SLRDATA_CODEC_BLOCK);
+			c->left--;
+		}
+
+		tuple_index = c->value;
+		c->next++;
+	}
+	else if (c->position)
+	{
+		if (c->position == c->end)
+			return false;
+
+		tuple_index = slrdata_get(c->width, c->position, 0);
+		c->position += c->width;
+	}
+	else
+	{
+		if (c->next == c->count)
+			return false;
+
+		tuple_index = c->next++;
+	}
+
+	*index = tuple_index;
+
+	return true;
+}
+
+// Decode the next tuple into tuple, its index in the tuple list is left in
+// c->index. Returns false once the cursor is exhausted.
+bool slrdata_cursor_next(slrdata_cursor_t *c, uint_fast64_t *tuple)
+{
+	uint_fast64_t tuple_index;
+
+	if (slrdata_cursor_step(c, &tuple_index))
+	{
+		slrdata_decode_tuple(c->width, c->tuple_list, c->arity, c->column_stride, tuple_index, tuple);
+	}
+	else if (c->delta_next < c->delta_count)
+	{
+		// then the tuples of the delta segment
+		if (c->delta_incidences)
+			tuple_index = slrdata_read(8, c->delta_incidences + c->delta_next * SLRDATA_DELTA_INCIDENCESIZE + 8);
+		else
+			tuple_index = c->delta_first + c->delta_next;
+		c->delta_next++;
+
+		const unsigned char *ptr = c->delta_tuples + (tuple_index - c->delta_first) * c->arity * 8;
+		for (uint_fast64_t j = 0; j < c->arity; j++)
+			tuple[j] = slrdata_read(8, ptr + j * 8);
+	}
+	else
+	{
+		return false;
+	}
+
+	c->index = tuple_index;
+
+	return true;
+}
+
+uint_fast64_t slrdata_element_count(slrdata_t *d)
+{
+	return d->element_count;
+}
+
+uint_fast64_t slrdata_relation_count(slrdata_t *d)
+{
+	if (d->is_relation)
+			return -1;
+
+	const unsigned char *catalog = slrdata_catalog(d);
+
+	return catalog ? slrdata_read(6, catalog + 6) : 0;
+}
+
+uint_fast64_t slrdata_tuple_count(slrdata_t *relation)
+{
+	if (!relation->is_relation)
+		return -1;
+
+	return relation->tuple_count + relation->delta_count;
+}
+
+// splitmix64, used to expand the seed into the generator state
+static uint64_t slrdata_splitmix64(uint64_t *x)
+{
+	uint64_t z = (*x += 0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+}
+
+// Seed the generator state rng[4] of a _r sampling function
+void slrdata_seed_r(uint64_t *rng, uint64_t seed)
+{
+	for (int i = 0; i < 4; i++)
+		rng[i] = slrdata_splitmix64(&seed);
+}
+
+// Seed the random number generator of the handle. Handles start seeded with 0
+// so that runs are reproducible.
+void slrdata_seed(slrdata_t *d, uint64_t seed)
+{
+	slrdata_seed_r(d->rng, seed);
+}
+
+static inline uint64_t slrdata_rotl(uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+// xoshiro256**
+static inline uint64_t slrdata_random(uint64_t *s)
+{
+	uint64_t result = slrdata_rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = slrdata_rotl(s[3], 45);
+
+	return result;
+}
+
+// Uniform in [0, n) without division (Lemire's multiply and reject)
+static inline uint64_t slrdata_random_below(uint64_t *s, uint64_t n)
+{
+	unsigned __int128 m = (unsigned __int128)slrdata_random(s) * n;
+	uint64_t l = (uint64_t)m;
+
+	if (l < n)
+	{
+		uint64_t t = -n % n;
+		while (l < t)
+		{
+			m = (unsigned __int128)slrdata_random(s) * n;
+			l = (uint64_t)m;
+		}
+	}
+
+	return m >> 64;
+}
+
+// Uniform random element of the element or relation file. The element count
+// must not be 0.
+uint_fast64_t slrdata_sample_element(slrdata_t *d)
+{
+	SLRDATA_STATS_QUERY(d, SLRDATA_STAT_SAMPLE, 1);
+	return slrdata_random_below(d->rng, d->element_count);
+}
+
+// The _r sampling functions draw from the generator state rng instead of the
+// one of the handle, so that threads sharing a read only handle can sample
+// with their own state.
+void slrdata_sample_elements_r(slrdata_t *d, uint64_t *rng, uint_fast64_t *elements, uint_fast64_t k)
+{
+	SLRDATA_STATS_QUERY(d, SLRDATA_STAT_SAMPLE, k);
+	for (uint_fast64_t j = 0; j < k; j++)
+		elements[j] = slrdata_random_below(rng, d->element_count);
+}
+
+void slrdata_sample_elements(slrdata_t *d, uint_fast64_t *elements, uint_fast64_t k)
+{
+	slrdata_sample_elements_r(d, d->rng, elements, k);
+}
+
+// Uniform random tuple of the relation, decoded into tuple. Returns its index
+// or -1 if the relation has no tuples.
+uint_fast64_t slrdata_sample_tuple(slrdata_t *relation, uint_fast64_t *tuple)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_SAMPLE, 1);
+	uint_fast64_t n = relation->tuple_count + relation->delta_count;
+	if (n == 0)
+		return -1;
+
+	uint_fast64_t i = slrdata_random_below(relation->rng, n);
+	slrdata_load_tuple(relation, i, tuple);
+
+	return i;
+}
+
+// k uniform random tuples, decoded one after another into tuples
+int slrdata_sample_tuples(slrdata_t *relation, uint_fast64_t *tuples, uint_fast64_t k)
+{
+	return slrdata_sample_tuples_r(relation, relation->rng, tuples, k);
+}
+
+int slrdata_sample_tuples_r(slrdata_t *relation, uint64_t *rng, uint_fast64_t *tuples, uint_fast64_t k)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_SAMPLE, k);
+	uint_fast64_t n = relation->tuple_count + relation->delta_count;
+	if (n == 0)
+		return(-1);
+
+	// draw a group of indices, then read their tuples with prefetching
+	uint_fast64_t indices[SLRDATA_PREFETCH_GROUP];
+	for (uint_fast64_t start = 0; start < k; start += SLRDATA_PREFETCH_GROUP)
+	{
+		uint_fast64_t m = k - start < SLRDATA_PREFETCH_GROUP ? k - start : SLRDATA_PREFETCH_GROUP;
+		for (uint_fast64_t j = 0; j < m; j++)
+		{
+			indices[j] = slrdata_random_below(rng, n);
+			slrdata_prefetch_tuple(relation, indices[j]);
+		}
+
+		for (uint_fast64_t j = 0; j < m; j++, tuples += relation->arity)
+			slrdata_load_tuple(relation, indices[j], tuples);
+	}
+
+	return(0);
+}
+
+// Uniform random tuple incident to element e, decoded into tuple. Returns its
+// position in the incidence list of e or -1 if e has degree 0.
+uint_fast64_t slrdata_sample_incidence(slrdata_t *relation, uint_fast64_t e, uint_fast64_t *tuple)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_SAMPLE, 1);
+	uint_fast64_t degree = slrdata_total_degree(relation, e);
+
+	if (degree == 0)
+		return -1;
+
+	uint_fast64_t i = slrdata_random_below(relation->rng, degree);
+	slrdata_load_tuple(relation, slrdata_incidence_at(relation, e, i), tuple);
+
+	return i;
+}
+
+// k uniform random tuples incident to element e, decoded one after another
+// into tuples
+int slrdata_sample_incidences(slrdata_t *relation, uint_fast64_t e, uint_fast64_t *tuples, uint_fast64_t k)
+{
+	return slrdata_sample_incidences_r(relation, relation->rng, e, tuples, k);
+}
+
+int slrdata_sample_incidences_r(slrdata_t *relation, uint64_t *rng, uint_fast64_t e, uint_fast64_t *tuples, uint_fast64_t k)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_SAMPLE, k);
+	uint_fast64_t degree = slrdata_total_degree(relation, e);
+
+	if (degree == 0)
+		return(-1);
+
+	uint_fast64_t elements[SLRDATA_PREFETCH_GROUP], indices[SLRDATA_PREFETCH_GROUP];
+	for (uint_fast64_t j = 0; j < SLRDATA_PREFETCH_GROUP; j++)
+		elements[j] = e;
+
+	for (uint_fast64_t start = 0; start < k; start += SLRDATA_PREFETCH_GROUP)
+	{
+		uint_fast64_t m = k - start < SLRDATA_PREFETCH_GROUP ? k - start : SLRDATA_PREFETCH_GROUP;
+		for (uint_fast64_t j = 0; j < m; j++)
+			indices[j] = slrdata_random_below(rng, degree);
+
+		slrdata_read_tuple_group(relation, elements, indices, m, tuples + start * relation->arity);
+	}
+
+	return(0);
+}
+
+// Build a Walker alias table over the degrees of the elements and store it in
+// the "degalias" section, so that elements can be sampled with probability
+// proportional to their degree in O(1). The incidence lists must exist.
+//
+// The section holds the total degree W followed by one (threshold, alias)
+// pair of 8 byte fields per element. Element j is kept if a uniform draw from
+// [0, W) is below its threshold, otherwise its alias is returned.
+int slrdata_add_degree_table(slrdata_t *relation)
+{
+	uint_fast64_t n = relation->element_count;
+	if (relation->element_list == NULL || n == 0)
+		return(-1);
+
+	unsigned __int128 *q = malloc(n * sizeof(unsigned __int128));
+	uint_fast64_t *worklist = malloc(n * sizeof(uint_fast64_t));
+	if (q == NULL || worklist == NULL)
+	{
+		free(q);
+		free(worklist);
+		return(-1);
+	}
+
+	uint_fast64_t total = 0;
+	for (uint_fast64_t e = 0; e < n; e++)
+		total += slrdata_base_degree(relation, e);
+
+	uint_fast64_t section_offset = slrdata_add_section(relation, "degalias", 8 + n * 16);
+	if (section_offset == 0)
+	{
+		free(q);
+		free(worklist);
+		return(-1);
+	}
+
+	unsigned char *table = relation->ptr + section_offset;
+	slrdata_write(8, table, total);
+	table += 8;
+
+	// scale the degrees so that every bucket holds exactly total, small
+	// elements are kept at the front of the worklist and large ones at the back
+	uint_fast64_t small = 0, large = n;
+	for (uint_fast64_t e = 0; e < n; e++)
+	{
+		q[e] = (unsigned __int128)slrdata_base_degree(relation, e) * n;
+
+		if (q[e] < total)
+			worklist[small++] = e;
+		else
+			worklist[--large] = e;
+	}
+
+	while (small > 0 && large < n)
+	{
+		uint_fast64_t s = worklist[--small];
+		uint_fast64_t l = worklist[large];
+
+		slrdata_write(8, table + s * 16, (uint_fast64_t)q[s]);
+		slrdata_write(8, table + s * 16 + 8, l);
+
+		q[l] -= total - q[s];
+		if (q[l] < total)
+		{
+			large++;
+			worklist[small++] = l;
+		}
+	}
+
+	// what is left fills its own bucket
+	while (small > 0)
+	{
+		uint_fast64_t s = worklist[--small];
+		slrdata_write(8, table + s * 16, total);
+		slrdata_write(8, table + s * 16 + 8, s);
+	}
+
+	while (large < n)
+	{
+		uint_fast64_t l = worklist[large++];
+		slrdata_write(8, table + l * 16, total);
+		slrdata_write(8, table + l * 16 + 8, l);
+	}
+
+	free(q);
+	free(worklist);
+
+	return(0);
+}
+
+// Draw an element with probability proportional to its degree. A draw below
+// the total degree of the incidence lists goes to the alias table, the others
+// pick an incidence of the delta segment.
+static inline uint_fast64_t slrdata_alias_draw(slrdata_t *relation, uint64_t *rng, uint_fast64_t total)
+{
+	uint_fast64_t delta_incidences = slrdata_delta_incidence_count(relation);
+	if (delta_incidences)
+	{
+		uint_fast64_t r = slrdata_random_below(rng, total + delta_incidences);
+		if (r >= total)
+			return slrdata_read(8, slrdata_delta_incidences(relation) + (r - total) * SLRDATA_DELTA_INCIDENCESIZE);
+	}
+
+	uint_fast64_t j = slrdata_random_below(rng, relation->element_count);
+	const unsigned char *bucket = relation->degree_table + 8 + j * 16;
+
+	if (slrdata_random_below(rng, total) < slrdata_read(8, bucket))
+		return j;
+
+	return slrdata_read(8, bucket + 8);
+}
+
+// Random element drawn with probability proportional to its degree. Returns -1
+// if the relation has no degree table or no incidences.
+uint_fast64_t slrdata_sample_element_by_degree(slrdata_t *relation)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_SAMPLE, 1);
+	if (relation->degree_table == NULL)
+		return -1;
+
+	uint_fast64_t total = slrdata_read(8, relation->degree_table);
+	if (total + slrdata_delta_incidence_count(relation) == 0)
+		return -1;
+
+	return slrdata_alias_draw(relation, relation->rng, total);
+}
+
+int slrdata_sample_elements_by_degree(slrdata_t *relation, uint_fast64_t *elements, uint_fast64_t k)
+{
+	return slrdata_sample_elements_by_degree_r(relation, relation->rng, elements, k);
+}
+
+int slrdata_sample_elements_by_degree_r(slrdata_t *relation, uint64_t *rng, uint_fast64_t *elements, uint_fast64_t k)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_SAMPLE, k);
+	if (relation->degree_table == NULL)
+		return(-1);
+
+	uint_fast64_t total = slrdata_read(8, relation->degree_table);
+	if (total + slrdata_delta_incidence_count(relation) == 0)
+		return(-1);
+
+	for (uint_fast64_t j = 0; j < k; j++)
+		elements[j] = slrdata_alias_draw(relation, rng, total);
+
+	return(0);
+}
+
+// one uniform random tuple incident to each of n elements, -1 tuples for
+// elements of degree 0
+static int slrdata_sample_incidence_group(slrdata_t *relation, uint64_t *rng, const uint_fast64_t *elements, uint_fast64_t n, uint_fast64_t *tuples)
+{
+	uint_fast64_t indices[SLRDATA_PREFETCH_GROUP];
+
+	slrdata_degrees(relation, elements, n, indices);
+	for (uint_fast64_t j = 0; j < n; j++)
+		indices[j] = indices[j] ? slrdata_random_below(rng, indices[j]) : (uint_fast64_t)-1;
+
+	return slrdata_read_tuple_group(relation, elements, indices, n, tuples);
+}
+
+// A parallel query split into chunks of requests. Every worker starts with an
+// equal range of chunks, takes chunks from the front of its own range and,
+// once that is empty, steals them from the back of the ranges of the others.
+struct slrdata_pool_job
+{
+	slrdata_t *relation;
+	uint_fast64_t count;
+	uint_fast64_t chunk;
+	unsigned threads;
+	// front and back chunk of the range of worker t, packed into the high and
+	// low 32 bits of ranges[t * SLRDATA_POOL_STRIDE]
+	uint64_t *ranges;
+	int (*run)(struct slrdata_pool_job *job, uint_fast64_t first, uint_fast64_t n, uint_fast64_t chunk);
+	const uint_fast64_t *elements;
+	const uint_fast64_t *indices;
+	uint_fast64_t *tuples;
+	uint64_t seed;
+	bool failed;
+};
+
+struct slrdata_pool_worker
+{
+	struct slrdata_pool_job *job;
+	unsigned t;
+	pthread_t thread;
+};
+
+// Take chunk *c from the front (own range) or back (stolen) of range t
+static bool slrdata_pool_take(uint64_t *range, bool own, uint_fast64_t *c)
+{
+	uint64_t r = __atomic_load_n(range, __ATOMIC_RELAXED);
+	for (;;)
+	{
+		uint64_t front = r >> 32, back = r & 0xffffffff;
+		if (front >= back)
+			return false;
+
+		uint64_t next = own ? ((front + 1) << 32) | back : (front << 32) | (back - 1);
+		if (__atomic_compare_exchange_n(range, &r, next, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		{
+			*c = own ? front : back - 1;
+			return true;
+		}
+	}
+}
+
+static void * slrdata_pool_thread(void *arg)
+{
+	struct slrdata_pool_worker *w = arg;
+	struct slrdata_pool_job *job = w->job;
+	uint_fast64_t c;
+
+	for (unsigned u = 0; u < job->threads; u++)
+	{
+		// own range first, then the others round robin
+		unsigned v = (w->t + u) % job->threads;
+		while (slrdata_pool_take(job->ranges + v * SLRDATA_POOL_STRIDE, u == 0, &c))
+		{
+			uint_fast64_t first = c * job->chunk;
+			uint_fast64_t n = job->count - first < job->chunk ? job->count - first : job->chunk;
+			if (job->run(job, first, n, c))
+				__atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+		}
+	}
+
+	return NULL;
+}
+
+// Run the job on the given number of threads, the calling thread being one of
+// them. Ranges of threads that cannot be started are stolen by the others.
+static int slrdata_pool_run(struct slrdata_pool_job *job, unsigned threads)
+{
+	if (threads == 0)
+		threads = 1;
+
+	job->chunk = SLRDATA_POOL_CHUNK;
+	while ((job->count + job->chunk - 1) / job->chunk > 0xffffffff)
+		job->chunk *= 2;
+	uint_fast64_t chunks = (job->count + job->chunk - 1) / job->chunk;
+	if (threads > chunks)
+		threads = chunks ? chunks : 1;
+
+	job->threads = threads;
+	job->failed = false;
+	job->ranges = calloc(threads * SLRDATA_POOL_STRIDE, sizeof(uint64_t));
+	struct slrdata_pool_worker *workers = calloc(threads, sizeof(struct slrdata_pool_worker));
+	bool started[threads];
+	if (job->ranges == NULL || workers == NULL)
+	{
+		free(job->ranges);
+		free(workers);
+		return(-1);
+	}
+
+	for (unsigned t = 0; t < threads; t++)
+		job->ranges[t * SLRDATA_POOL_STRIDE] = ((chunks * t / threads) << 32) | (chunks * (t + 1) / threads);
+
+	for (unsigned t = 0; t < threads; t++)
+	{
+		workers[t].job = job;
+		workers[t].t = t;
+		started[t] = t > 0 && pthread_create(&workers[t].thread, NULL, slrdata_pool_thread, &workers[t]) == 0;
+	}
+
+	slrdata_pool_thread(&workers[0]);
+
+	for (unsigned t = 1; t < threads; t++)
+		if (started[t])
+			pthread_join(workers[t].thread, NULL);
+
+	free(job->ranges);
+	free(workers);
+
+	return job->failed ? -1 : 0;
+}
+
+// generator state of chunk c, so that samples do not depend on which thread
+// took the chunk
+static void slrdata_pool_seed(struct slrdata_pool_job *job, uint_fast64_t c, uint64_t *rng)
+{
+	uint64_t x = job->seed + c * 0xd1b54a32d192ed03;
+	slrdata_seed_r(rng, slrdata_splitmix64(&x));
+}
+
+static int slrdata_pool_read_tuples(struct slrdata_pool_job *job, uint_fast64_t first, uint_fast64_t n, uint_fast64_t c)
+{
+	return slrdata_read_tuples(job->relation, job->elements + first, job->indices + first, n, job->tuples + first * job->relation->arity);
+}
+
+static int slrdata_pool_read_ith_tuples(struct slrdata_pool_job *job, uint_fast64_t first, uint_fast64_t n, uint_fast64_t c)
+{
+	return slrdata_read_ith_tuples(job->relation, job->indices + first, n, job->tuples + first * job->relation->arity);
+}
+
+static int slrdata_pool_sample_tuples(struct slrdata_pool_job *job, uint_fast64_t first, uint_fast64_t n, uint_fast64_t c)
+{
+	uint64_t rng[4];
+	slrdata_pool_seed(job, c, rng);
+
+	return slrdata_sample_tuples_r(job->relation, rng, job->tuples + first * job->relation->arity, n);
+}
+
+static int slrdata_pool_sample_incidences(struct slrdata_pool_job *job, uint_fast64_t first, uint_fast64_t n, uint_fast64_t c)
+{
+	uint64_t rng[4];
+	int ret = 0;
+	slrdata_pool_seed(job, c, rng);
+
+	for (uint_fast64_t start = first; start < first + n; start += SLRDATA_PREFETCH_GROUP)
+	{
+		uint_fast64_t m = first + n - start < SLRDATA_PREFETCH_GROUP ? first + n - start : SLRDATA_PREFETCH_GROUP;
+		if (slrdata_sample_incidence_group(job->relation, rng, job->elements + start, m, job->tuples + start * job->relation->arity))
+			ret = -1;
+	}
+
+	return(ret);
+}
+
+// slrdata_read_tuples spread over a pool of threads. The handle is only read,
+// so it can be shared by the threads as long as nobody changes it meanwhile.
+int slrdata_parallel_read_tuples(slrdata_t *relation, const uint_fast64_t *elements, const uint_fast64_t *indices, uint_fast64_t count, uint_fast64_t *tuples, unsigned threads)
+{
+	struct slrdata_pool_job job = { .relation = relation, .count = count, .run = slrdata_pool_read_tuples,
+		.elements = elements, .indices = indices, .tuples = tuples };
+
+	return slrdata_pool_run(&job, threads);
+}
+
+// slrdata_read_ith_tuples spread over a pool of threads
+int slrdata_parallel_read_ith_tuples(slrdata_t *relation, const uint_fast64_t *indices, uint_fast64_t count, uint_fast64_t *tuples, unsigned threads)
+{
+	struct slrdata_pool_job job = { .relation = relation, .count = count, .run = slrdata_pool_read_ith_tuples,
+		.indices = indices, .tuples = tuples };
+
+	return slrdata_pool_run(&job, threads);
+}
+
+// k uniform random tuples drawn by a pool of threads. Every chunk of samples
+// has its own generator derived from seed, so the result depends on the seed
+// only, not on the number of threads or their timing; the generator of the
+// handle is not used.
+int slrdata_parallel_sample_tuples(slrdata_t *relation, uint64_t seed, uint_fast64_t *tuples, uint_fast64_t k, unsigned threads)
+{
+	if (relation->tuple_count + relation->delta_count == 0)
+		return(-1);
+
+	struct slrdata_pool_job job = { .relation = relation, .count = k, .run = slrdata_pool_sample_tuples,
+		.tuples = tuples, .seed = seed };
+
+	return slrdata_pool_run(&job, threads);
+}
+
+// One uniform random tuple incident to each of the count elements, drawn by a
+// pool of threads as in slrdata_parallel_sample_tuples. Elements of degree 0
+// get tuples of -1 and make the call return -1.
+int slrdata_parallel_sample_incidences(slrdata_t *relation, uint64_t seed, const uint_fast64_t *elements, uint_fast64_t count, uint_fast64_t *tuples, unsigned threads)
+{
+	struct slrdata_pool_job job = { .relation = relation, .count = count, .run = slrdata_pool_sample_incidences,
+		.elements = elements, .tuples = tuples, .seed = seed };
+
+	return slrdata_pool_run(&job, threads);
+}
+
+// Lexicographic order of the tuples with the given indices, ties broken by index
+static int slrdata_compare_tuples(slrdata_t *relation, uint_fast64_t a, uint_fast64_t b)
+{
+	for (uint_fast64_t j = 0; j < relation->arity; j++)
+	{
+		uint_fast64_t u = slrdata_tuple_field(relation, a, j), v = slrdata_tuple_field(relation, b, j);
+		if (u != v)
+			return u < v ? -1 : 1;
+	}
+
+	return a < b ? -1 : (a > b);
+}
+
+// Order of the tuple with index a and the decoded tuple
+static int slrdata_compare_tuple(slrdata_t *relation, uint_fast64_t a, const uint_fast64_t *tuple)
+{
+	for (uint_fast64_t j = 0; j < relation->arity; j++)
+	{
+		uint_fast64_t u = slrdata_tuple_field(relation, a, j);
+		if (u != tuple[j])
+			return u < tuple[j] ? -1 : 1;
+	}
+
+	return 0;
+}
+
+// Bottom up merge sort of tuple indices by their tuples, tmp holds n entries
+static void slrdata_sort_tuple_indices(slrdata_t *relation, uint_fast64_t *indices, uint_fast64_t *tmp, uint_fast64_t n)
+{
+	uint_fast64_t *from = indices, *to = tmp;
+
+	for (uint_fast64_t width = 1; width < n; width *= 2)
+	{
+		for (uint_fast64_t lo = 0; lo < n; lo += 2 * width)
+		{
+			uint_fast64_t mid = lo + width < n ? lo + width : n;
+			uint_fast64_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+			uint_fast64_t i = lo, j = mid, k = lo;
+
+			while (i < mid && j < hi)
+				to[k++] = slrdata_compare_tuples(relation, from[i], from[j]) <= 0 ? from[i++] : from[j++];
+			while (i < mid)
+				to[k++] = from[i++];
+			while (j < hi)
+				to[k++] = from[j++];
+		}
+
+		uint_fast64_t *swap = from;
+		from = to;
+		to = swap;
+	}
+
+	if (from != indices)
+		memcpy(indices, from, n * sizeof(uint_fast64_t));
+}
+
+// The neighbor table of a binary relation ("neighbor" section) holds, for
+// every incidence of the incidence lists in list order, the other element of
+// its tuple. After the number of slots per element (0 if every element has a
+// list of its own length), the field width and the element count come either
+// element count * slots fields, unused slots all ones, or element count + 1
+// list offsets followed by the fields. Delta tuples are not in the table.
+#define SLRDATA_NEIGHBOR_HEADERSIZE 24
+
+// Fill the neighbor table from the incidence lists in their current order
+static void slrdata_fill_neighbor_table(slrdata_t *relation, unsigned char *table)
+{
+	uint_fast64_t slots = slrdata_read(8, table);
+	uint_fast8_t width = slrdata_read(8, table + 8);
+	uint_fast64_t n = slrdata_read(8, table + 16);
+	unsigned char *neighbors = table + SLRDATA_NEIGHBOR_HEADERSIZE + (slots ? 0 : (n + 1) * 8);
+
+	uint64_t indices[SLRDATA_SCAN_BLOCK];
+	uint_fast64_t next = 0;
+	for (uint_fast64_t e = 0; e < n; e++)
+	{
+		uint_fast64_t degree = slrdata_base_degree(relation, e);
+		uint_fast64_t first = slots ? e * slots : next;
+		if (!slots)
+			slrdata_write(8, table + SLRDATA_NEIGHBOR_HEADERSIZE + e * 8, next);
+
+		for (uint_fast64_t done = 0; done < degree; done += SLRDATA_SCAN_BLOCK)
+		{
+			uint_fast64_t count = degree - done < SLRDATA_SCAN_BLOCK ? degree - done : SLRDATA_SCAN_BLOCK;
+			slrdata_decode_incidences(relation, slrdata_incidence_list(relation, e), done, count, indices);
+
+			for (uint_fast64_t i = 0; i < count; i++)
+			{
+				uint_fast64_t other = slrdata_tuple_field(relation, indices[i], 0);
+				if (other == e)
+					other = slrdata_tuple_field(relation, indices[i], 1);
+				slrdata_set(width, neighbors, first + done + i, other);
+			}
+		}
+
+		for (uint_fast64_t j = degree; slots && j < slots; j++)
+			slrdata_set(width, neighbors, first + j, width == 4 ? UINT32_MAX : UINT64_MAX);
+
+		next += degree;
+	}
+
+	if (!slots)
+		slrdata_write(8, table + SLRDATA_NEIGHBOR_HEADERSIZE + n * 8, next);
+}
+
+// Build the neighbor table of a binary relation from its incidence lists, so
+// that the j-th neighbor of an element is read with one access instead of an
+// incidence and a tuple. With slots, every element gets that many slots and a
+// neighbor query is a single load as in the bounded degree model; an element
+// with more incidences fails the build. Without, the lists are packed.
+int slrdata_add_neighbor_table(slrdata_t *relation, uint_fast64_t slots)
+{
+	uint_fast64_t n = relation->element_count;
+	if (relation->arity != 2 || relation->element_list == NULL)
+		return(-1);
+
+	uint_fast64_t total = 0;
+	for (uint_fast64_t e = 0; e < n; e++)
+	{
+		uint_fast64_t degree = slrdata_base_degree(relation, e);
+		if (slots && degree > slots)
+			return(-1);
+
+		total += degree;
+	}
+
+	// all ones marks an unused slot
+	uint_fast8_t width = n < UINT32_MAX ? 4 : 8;
+	uint_fast64_t offsets_size = slots ? 0 : (n + 1) * 8;
+	uint_fast64_t fields = slots ? n * slots : total;
+	uint_fast64_t section_offset = slrdata_add_section(relation, "neighbor", SLRDATA_NEIGHBOR_HEADERSIZE + offsets_size + fields * width);
+	if (section_offset == 0)
+		return(-1);
+
+	unsigned char *table = relation->ptr + section_offset;
+	slrdata_write(8, table, slots);
+	slrdata_write(8, table + 8, width);
+	slrdata_write(8, table + 16, n);
+	slrdata_fill_neighbor_table(relation, table);
+
+	return(0);
+}
+
+// Sort every incidence list by the lexicographic order of its tuples and record
+// it in the "incorder" section, so that slrdata_has_tuple and slrdata_adjacent
+// can binary search them. A neighbor table is refilled in the new order.
+int slrdata_sort_incidence_lists(slrdata_t *relation)
+{
+	// compressed lists stay in tuple index order
+	if (relation->element_list == NULL || relation->compressed)
+		return(-1);
+
+	uint_fast64_t max_degree = 0;
+	for (uint_fast64_t e = 0; e < relation->element_count; e++)
+	{
+		uint_fast64_t degree = slrdata_base_degree(relation, e);
+		if (degree > max_degree)
+			max_degree = degree;
+	}
+
+	uint_fast64_t order_offset = slrdata_add_section(relation, "incorder", 8);
+	if (order_offset == 0)
+		return(-1);
+
+	uint_fast64_t *indices = malloc((2 * max_degree + 1) * sizeof(uint_fast64_t));
+	if (indices == NULL)
+		return(-1);
+
+	for (uint_fast64_t e = 0; e < relation->element_count; e++)
+	{
+		unsigned char *incidence = (unsigned char *)slrdata_incidence_list(relation, e) + SLRDATA_RELATION_LISTHEADERSIZE;
+		uint_fast64_t degree = slrdata_base_degree(relation, e);
+
+		for (uint_fast64_t i = 0; i < degree; i++)
+			indices[i] = slrdata_get(relation->width, incidence, i);
+
+		slrdata_sort_tuple_indices(relation, indices, indices + max_degree, degree);
+
+		for (uint_fast64_t i = 0; i < degree; i++)
+			slrdata_set(relation->width, incidence, i, indices[i]);
+	}
+
+	free(indices);
+
+	slrdata_write(8, relation->ptr + order_offset, SLRDATA_ORDER_TUPLE);
+	slrdata_refresh(relation);
+
+	// the neighbor table follows the lists, its slots stay the same
+	if (relation->neighbors)
+		slrdata_fill_neighbor_table(relation, (unsigned char *)relation->neighbors);
+
+	return(0);
+}
+
+#define SLRDATA_HASH_EMPTY 0
+#define SLRDATA_HASH_INDEXBITS 48
+
+static uint64_t slrdata_hash_tuple(const uint_fast64_t *tuple, uint_fast64_t arity)
+{
+	uint64_t h = arity;
+
+	for (uint_fast64_t j = 0; j < arity; j++)
+	{
+		h = (h ^ tuple[j]) * 0x9e3779b97f4a7c15;
+		h ^= h >> 29;
+	}
+
+	h *= 0xbf58476d1ce4e5b9;
+	return h ^ (h >> 32);
+}
+
+// Build an open addressing hash index over the tuple list in the "tuplhash"
+// section, in one pass. The section holds the number of slots (a power of two
+// at least twice the tuple count) and the slots. A slot is 8 bytes: the tuple
+// index plus one in the low 48 bits, 0 for an empty slot, and 16 bits of the
+// hash in the high bits so that a lookup rarely reads a tuple that does not
+// match. Slots are picked from the high bits of the hash and probed linearly,
+// so a lookup usually stays within one cache line of slots. The tuple list
+// must be final, so the incidence lists have to be built first.
+int slrdata_add_hash_index(slrdata_t *relation)
+{
+	// the tuple list is final once the incidence lists are built
+	if (!relation->is_relation || relation->version < 2 || relation->element_list == NULL)
+		return(-1);
+
+	uint_fast64_t slot_bits = 3;
+	while (((uint_fast64_t)1 << slot_bits) < 2 * relation->tuple_count)
+		slot_bits++;
+
+	uint_fast64_t slot_count = (uint_fast64_t)1 << slot_bits;
+	uint_fast64_t section_offset = slrdata_add_section(relation, "tuplhash", 8 + slot_count * 8);
+	if (section_offset == 0)
+		return(-1);
+
+	unsigned char *index = relation->ptr + section_offset;
+	slrdata_write(8, index, slot_count);
+
+	unsigned char *slots = index + 8;
+	memset(slots, 0, slot_count * 8);
+
+	uint_fast64_t tuple[relation->arity ? relation->arity : 1];
+	for (uint_fast64_t i = 0; i < relation->tuple_count; i++)
+	{
+		slrdata_decode_tuple(relation->width, relation->tuple_list, relation->arity, relation->column_stride, i, tuple);
+
+		uint64_t h = slrdata_hash_tuple(tuple, relation->arity);
+		uint_fast64_t slot = h >> (64 - slot_bits);
+
+		while (slrdata_read(8, slots + slot * 8) != SLRDATA_HASH_EMPTY)
+			slot = (slot + 1) & (slot_count - 1);
+
+		slrdata_write(8, slots + slot * 8, ((h & 0xffff) << SLRDATA_HASH_INDEXBITS) | (i + 1));
+	}
+
+	slrdata_refresh(relation);
+
+	return(0);
+}
+
+static uint_fast64_t slrdata_hash_lookup(slrdata_t *relation, const uint_fast64_t *tuple)
+{
+	const unsigned char *slots = relation->hash_index + 8;
+	uint_fast64_t slot_count = slrdata_read(8, relation->hash_index);
+	uint_fast64_t slot_bits = __builtin_ctzll(slot_count);
+
+	uint64_t h = slrdata_hash_tuple(tuple, relation->arity);
+	uint_fast64_t slot = h >> (64 - slot_bits);
+	uint_fast64_t fingerprint = h & 0xffff;
+
+	for (;;)
+	{
+		uint_fast64_t entry = slrdata_read(8, slots + slot * 8);
+		if (entry == SLRDATA_HASH_EMPTY)
+			return -1;
+
+		uint_fast64_t tuple_index = (entry & (((uint_fast64_t)1 << SLRDATA_HASH_INDEXBITS) - 1)) - 1;
+		if ((entry >> SLRDATA_HASH_INDEXBITS) == fingerprint && slrdata_compare_tuple(relation, tuple_index, tuple) == 0)
+			return tuple_index;
+
+		slot = (slot + 1) & (slot_count - 1);
+	}
+}
+
+// Index of the given tuple in the incidence list of e, or -1. Binary searches
+// sorted incidence lists and scans the others.
+static uint_fast64_t slrdata_find_incidence(slrdata_t *relation, uint_fast64_t e, const uint_fast64_t *tuple)
+{
+	const unsigned char *incidence_list = slrdata_incidence_list(relation, e);
+	const unsigned char *incidence = incidence_list + SLRDATA_RELATION_LISTHEADERSIZE;
+	uint_fast64_t degree = slrdata_read(6, incidence_list + 6);
+
+	if (relation->sorted)
+	{
+		uint_fast64_t lo = 0, hi = degree;
+		while (lo < hi)
+		{
+			uint_fast64_t mid = lo + (hi - lo) / 2;
+			uint_fast64_t tuple_index = slrdata_get(relation->width, incidence, mid);
+			int c = slrdata_compare_tuple(relation, tuple_index, tuple);
+
+			if (c == 0)
+				return tuple_index;
+			if (c < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		return -1;
+	}
+
+	uint64_t block[SLRDATA_CODEC_BLOCK];
+	for (uint_fast64_t first = 0; first < degree; first += SLRDATA_CODEC_BLOCK)
+	{
+		uint_fast64_t n = degree - first < SLRDATA_CODEC_BLOCK ? degree - first : SLRDATA_CODEC_BLOCK;
+		slrdata_decode_incidences(relation, incidence_list, first, n, block);
+
+		for (uint_fast64_t i = 0; i < n; i++)
+			if (slrdata_compare_tuple(relation, block[i], tuple) == 0)
+				return block[i];
+	}
+
+	return -1;
+}
+
+// Index of the given tuple in the tuple list, or -1 if it is not in the
+// relation. Uses the hash index if there is one, otherwise only the incidence list of the element of least degree in the
+// tuple is searched.
+static uint_fast64_t slrdata_find_base_tuple(slrdata_t *relation, const uint_fast64_t *tuple)
+{
+	if (relation->hash_index)
+		return slrdata_hash_lookup(relation, tuple);
+
+	if (relation->element_list == NULL || relation->arity == 0)
+		return -1;
+
+	uint_fast64_t e = tuple[0];
+	uint_fast64_t degree = -1;
+	for (uint_fast64_t j = 0; j < relation->arity; j++)
+	{
+		if (tuple[j] >= relation->element_count)
+			return -1;
+
+		uint_fast64_t d = slrdata_base_degree(relation, tuple[j]);
+		if (d < degree)
+		{
+			e = tuple[j];
+			degree = d;
+		}
+	}
+
+	return slrdata_find_incidence(relation, e, tuple);
+}
+
+// Index of the given tuple in the delta segment, among the delta incidences of
+// its first element, or -1
+static uint_fast64_t slrdata_find_delta_tuple(slrdata_t *relation, const uint_fast64_t *tuple)
+{
+	uint_fast64_t first;
+	uint_fast64_t count = relation->arity ? slrdata_delta_range(relation, tuple[0], &first) : 0;
+
+	for (uint_fast64_t i = first; i < first + count; i++)
+	{
+		uint_fast64_t tuple_index = slrdata_delta_incidence(relation, i);
+		const unsigned char *ptr = slrdata_delta_tuple(relation, tuple_index - relation->tuple_count);
+		uint_fast64_t j = 0;
+
+		while (j < relation->arity && slrdata_read(8, ptr + j * 8) == tuple[j])
+			j++;
+
+		if (j == relation->arity)
+			return tuple_index;
+	}
+
+	return -1;
+}
+
+// Index of the given tuple, or -1 if it is not in the relation. The delta
+// segment is searched after the base.
+uint_fast64_t slrdata_find_tuple(slrdata_t *relation, const uint_fast64_t *tuple)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_LOOKUP, 1);
+	uint_fast64_t tuple_index = slrdata_find_base_tuple(relation, tuple);
+
+	if (tuple_index == (uint_fast64_t)-1 && relation->delta_count)
+		tuple_index = slrdata_find_delta_tuple(relation, tuple);
+
+	return tuple_index;
+}
+
+bool slrdata_has_tuple(slrdata_t *relation, const uint_fast64_t *tuple)
+{
+	return slrdata_find_tuple(relation, tuple) != (uint_fast64_t)-1;
+}
+
+// Whether some tuple of the base contains both u and v (twice if u == v). For
+// sorted binary relations this is two binary searches of the smaller incidence
+// list, otherwise the smaller list is scanned.
+static bool slrdata_adjacent_base(slrdata_t *relation, uint_fast64_t u, uint_fast64_t v)
+{
+	if (relation->element_list == NULL || u >= relation->element_count || v >= relation->element_count)
+		return false;
+
+	if (slrdata_base_degree(relation, v) < slrdata_base_degree(relation, u))
+	{
+		uint_fast64_t swap = u;
+		u = v;
+		v = swap;
+	}
+
+	if (relation->sorted && relation->arity == 2)
+	{
+		uint_fast64_t tuple[2] = { u, v };
+		if (slrdata_find_incidence(relation, u, tuple) != (uint_fast64_t)-1)
+			return true;
+
+		tuple[0] = v;
+		tuple[1] = u;
+		return slrdata_find_incidence(relation, u, tuple) != (uint_fast64_t)-1;
+	}
+
+	const unsigned char *incidence_list = slrdata_incidence_list(relation, u);
+	uint_fast64_t degree = slrdata_read(6, incidence_list + 6);
+	uint64_t block[SLRDATA_CODEC_BLOCK];
+	for (uint_fast64_t first = 0; first < degree; first += SLRDATA_CODEC_BLOCK)
+	{
+		uint_fast64_t n = degree - first < SLRDATA_CODEC_BLOCK ? degree - first : SLRDATA_CODEC_BLOCK;
+		slrdata_decode_incidences(relation, incidence_list, first, n, block);
+
+		for (uint_fast64_t i = 0; i < n; i++)
+		{
+			// compressed lists are intersected without reading the tuples
+			if (relation->compressed && u != v)
+			{
+				if (slrdata_has_incidence(slrdata_incidence_list(relation, v), block[i]))
+					return true;
+				continue;
+			}
+
+			uint_fast64_t found = 0;
+			for (uint_fast64_t j = 0; j < relation->arity; j++)
+				found += slrdata_tuple_field(relation, block[i], j) == v;
+
+			if (found > (u == v))
+				return true;
+		}
+	}
+
+	return false;
+}
+
+// Whether some tuple contains both u and v (twice if u == v), in the base or
+// the delta segment
+bool slrdata_adjacent(slrdata_t *relation, uint_fast64_t u, uint_fast64_t v)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_LOOKUP, 1);
+	if (slrdata_adjacent_base(relation, u, v))
+		return true;
+
+	uint_fast64_t first;
+	uint_fast64_t count = slrdata_delta_range(relation, u, &first);
+	for (uint_fast64_t i = first; i < first + count; i++)
+	{
+		const unsigned char *ptr = slrdata_delta_tuple(relation, slrdata_delta_incidence(relation, i) - relation->tuple_count);
+		uint_fast64_t found = 0;
+
+		for (uint_fast64_t j = 0; j < relation->arity; j++)
+			found += slrdata_read(8, ptr + j * 8) == v;
+
+		if (found > (u == v))
+			return true;
+	}
+
+	return false;
+}
+
+// j-th neighbor of v in the neighbor table, -1 if it is not in it
+static inline uint_fast64_t slrdata_table_neighbor(const unsigned char *table, uint_fast64_t v, uint_fast64_t j)
+{
+	uint_fast64_t slots = slrdata_read(8, table);
+	uint_fast8_t width = slrdata_read(8, table + 8);
+	uint_fast64_t n = slrdata_read(8, table + 16);
+	if (v >= n)
+		return -1;
+
+	if (slots)
+	{
+		if (j >= slots)
+			return -1;
+
+		uint_fast64_t other = slrdata_get(width, table + SLRDATA_NEIGHBOR_HEADERSIZE, v * slots + j);
+		return width == 4 && other == UINT32_MAX ? (uint_fast64_t)-1 : other;
+	}
+
+	const unsigned char *offsets = table + SLRDATA_NEIGHBOR_HEADERSIZE;
+	uint_fast64_t first = slrdata_read(8, offsets + v * 8);
+	if (j >= slrdata_read(8, offsets + v * 8 + 8) - first)
+		return -1;
+
+	return slrdata_get(width, offsets + (n + 1) * 8, first + j);
+}
+
+// j-th neighbor of v in a binary relation: the other element of the tuple of
+// the j-th incidence of v, v itself for a loop. Returns -1 (no neighbor) if v
+// has at most j incidences. Reads the neighbor table if there is one.
+uint_fast64_t slrdata_neighbor(slrdata_t *relation, uint_fast64_t v, uint_fast64_t j)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_NEIGHBOR, 1);
+	if (relation->arity != 2)
+		return -1;
+
+	if (relation->neighbors)
+	{
+		uint_fast64_t other = slrdata_table_neighbor(relation->neighbors, v, j);
+
+		// without delta tuples the table has all incidences
+		if (other != (uint_fast64_t)-1 || relation->delta_count == 0)
+			return other;
+	}
+
+	uint_fast64_t tuple_index = slrdata_incidence_at(relation, v, j);
+	if (tuple_index == (uint_fast64_t)-1)
+		return -1;
+
+	uint_fast64_t tuple[2];
+	slrdata_load_tuple(relation, tuple_index, tuple);
+
+	return tuple[0] == v ? tuple[1] : tuple[0];
+}
+
+// Write up to count neighbors of v, starting with the first-th, to neighbors.
+// Returns the number written.
+uint_fast64_t slrdata_scan_neighbors(slrdata_t *relation, uint_fast64_t v, uint_fast64_t first, uint_fast64_t count, uint64_t *neighbors)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_NEIGHBOR, count);
+	if (relation->arity != 2)
+		return 0;
+
+	// the incidences are read first, the tuples loaded after them
+	uint_fast64_t table_count = 0;
+	if (relation->neighbors)
+	{
+		while (table_count < count)
+		{
+			uint_fast64_t other = slrdata_table_neighbor(relation->neighbors, v, first + table_count);
+			if (other == (uint_fast64_t)-1)
+				break;
+
+			neighbors[table_count++] = other;
+		}
+
+		if (table_count == count || relation->delta_count == 0)
+			return table_count;
+	}
+
+	count = slrdata_scan_incidences(relation, v, first + table_count, count - table_count, neighbors + table_count);
+	for (uint_fast64_t i = table_count; i < table_count + count; i++)
+	{
+		uint_fast64_t tuple[2];
+		slrdata_load_tuple(relation, neighbors[i], tuple);
+		neighbors[i] = tuple[0] == v ? tuple[1] : tuple[0];
+	}
+
+	return table_count + count;
+}
+
+// Decode up to count tuples starting at tuple first into tuples, arity values
+// per tuple. Returns the number of tuples decoded.
+uint_fast64_t slrdata_scan_tuples(slrdata_t *relation, uint_fast64_t first, uint_fast64_t count, uint64_t *tuples)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_SCAN, count);
+	uint_fast64_t tuple_count = relation->tuple_count + relation->delta_count;
+	if (first >= tuple_count)
+		return 0;
+
+	if (count > tuple_count - first)
+		count = tuple_count - first;
+
+	uint_fast64_t base = first < relation->tuple_count ? relation->tuple_count - first : 0;
+	if (base > count)
+		base = count;
+	slrdata_decode_tuples(relation->width, relation->tuple_list, relation->arity, relation->column_stride, first, base, tuples);
+
+	for (uint_fast64_t i = base; i < count; i++)
+		slrdata_load_tuple(relation, first + i, tuples + i * relation->arity);
+
+	return count;
+}
+
+// Decode up to count values of the given position of the tuples starting at
+// tuple first into values. Returns the number of values decoded. Only the
+// column is read if the relation is columnar.
+uint_fast64_t slrdata_scan_column(slrdata_t *relation, uint_fast64_t position, uint_fast64_t first, uint_fast64_t count, uint64_t *values)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_SCAN, count);
+	uint_fast64_t tuple_count = relation->tuple_count + relation->delta_count;
+	if (first >= tuple_count || position >= relation->arity)
+		return 0;
+
+	if (count > tuple_count - first)
+		count = tuple_count - first;
+
+	uint_fast64_t base = first < relation->tuple_count ? relation->tuple_count - first : 0;
+	if (base > count)
+		base = count;
+
+	if (relation->column_stride)
+	{
+		slrdata_decode(relation->width, relation->tuple_list + (position * relation->column_stride + first) * relation->width, values, base);
+	}
+	else
+	{
+		for (uint_fast64_t i = 0; i < base; i++)
+			values[i] = slrdata_tuple_field(relation, first + i, position);
+	}
+
+	for (uint_fast64_t i = base; i < count; i++)
+		values[i] = slrdata_read(8, slrdata_delta_tuple(relation, first + i - relation->tuple_count) + position * 8);
+
+	return count;
+}
+
+// Decode up to count tuple indices of the incidence list of e starting at
+// position first into indices. Returns the number of indices decoded.
+uint_fast64_t slrdata_scan_incidences(slrdata_t *relation, uint_fast64_t e, uint_fast64_t first, uint_fast64_t count, uint64_t *indices)
+{
+	SLRDATA_STATS_QUERY(relation, SLRDATA_STAT_SCAN, count);
+	uint_fast64_t degree = slrdata_base_degree(relation, e);
+	uint_fast64_t delta_first;
+	uint_fast64_t delta_count = slrdata_delta_range(relation, e, &delta_first);
+
+	if (first >= degree + delta_count)
+		return 0;
+
+	if (count > degree + delta_count - first)
+		count = degree + delta_count - first;
+
+	uint_fast64_t base = first < degree ? degree - first : 0;
+	if (base > count)
+		base = count;
+	if (base)
+		slrdata_decode_incidences(relation, slrdata_incidence_list(relation, e), first, base, indices);
+
+	for (uint_fast64_t i = base; i < count; i++)
+		indices[i] = slrdata_delta_incidence(relation, delta_first + first + i - degree);
+
+	return count;
+}
+
+// (element, tuple index) pair of the external sort used by slrdata_import
+struct slrdata_import_pair
+{
+	uint64_t element;
+	uint64_t tuple;
+};
+
+// sorted run of pairs, either in memory or the pairs [first, end) of the run
+// file read through a buffer
+struct slrdata_import_run
+{
+	uint64_t first;
+	uint64_t end;
+	struct slrdata_import_pair *buffer;
+	size_t capacity;
+	size_t count;
+	size_t next;
+};
+
+struct slrdata_import
+{
+	const struct slrdata_import_options *options;
+	const char *foldername;
+	slrdata_builder_t builder;
+	uint_fast64_t arity;
+	uint_fast64_t element_count;
+	uint_fast64_t tuple_count;
+	// element file, whose label index gives the ids of labels
+	slrdata_t *elements;
+	struct slrdata_import_pair *pairs;
+	size_t pair_capacity;
+	size_t pair_count;
+	// unlinked temporary file holding all runs, -1 until the first is written,
+	// and the number of pairs in it
+	int fd;
+	uint64_t file_pairs;
+	struct slrdata_import_run *runs;
+	size_t run_count;
+};
+
+// k-way merge of runs with a binary min heap of the runs ordered by their
+// current pair
+struct slrdata_import_merge
+{
+	struct slrdata_import_run *runs;
+	size_t *heap;
+	struct slrdata_import_pair *current;
+	size_t size;
+};
+
+static int slrdata_import_compare(const void *a, const void *b)
+{
+	const struct slrdata_import_pair *x = a, *y = b;
+
+	if (x->element != y->element)
+		return x->element < y->element ? -1 : 1;
+
+	return (x->tuple > y->tuple) - (x->tuple < y->tuple);
+}
+
+// Id of the label in the element file, adding an element for it if it is
+// new. Returns -1 if it cannot be added.
+static uint_fast64_t slrdata_import_label(struct slrdata_import *im, const char *label, size_t length)
+{
+	uint_fast64_t id = slrdata_find_element(im->elements, label, length);
+	if (id != (uint_fast64_t)-1)
+		return id;
+
+	if (slrdata_add_labeled_elements(im->elements, &label, &length, 1))
+		return -1;
+
+	return im->elements->element_count - 1;
+}
+
+// Unlinked temporary file in the folder, -1 if it cannot be made
+static int slrdata_import_tempfile(struct slrdata_import *im)
+{
+	char *path = slrdata_filepath(im->foldername, ".import-XXXXXX");
+	// mkstemp wants the X at the end, drop the extension
+	path[strlen(path) - 4] = '\0';
+
+	int fd = mkstemp(path);
+	if (fd != -1)
+		unlink(path);
+	free(path);
+
+	return fd;
+}
+
+// Write count pairs to fd at pair position first
+static int slrdata_import_write(int fd, uint64_t first, const struct slrdata_import_pair *pairs, size_t count)
+{
+	const unsigned char *p = (const unsigned char *)pairs;
+	size_t left = count * sizeof(struct slrdata_import_pair);
+	off_t offset = first * sizeof(struct slrdata_import_pair);
+
+	while (left)
+	{
+		ssize_t n = pwrite(fd, p, left, offset);
+		if (n <= 0)
+			return(-1);
+
+		p += n;
+		left -= n;
+		offset += n;
 	}
 
-	slrdata_resize(d, size + 8, false);
-	slrdata_write(8, d->ptr + SLRDATA_HEADERSIZE_BASIC, 0);
+	return(0);
+}
+
+// Sort the buffered pairs and append them to the run file as a new run
+static int slrdata_import_flush(struct slrdata_import *im)
+{
+	qsort(im->pairs, im->pair_count, sizeof(struct slrdata_import_pair), slrdata_import_compare);
+
+	if (im->fd == -1 && (im->fd = slrdata_import_tempfile(im)) == -1)
+		return(-1);
 
-	d->foldername = foldername;
-	d->filename = "elements";
+	struct slrdata_import_run *runs = realloc(im->runs, (im->run_count + 1) * sizeof(struct slrdata_import_run));
+	if (runs == NULL)
+		return(-1);
+
+	im->runs = runs;
+	if (slrdata_import_write(im->fd, im->file_pairs, im->pairs, im->pair_count))
+		return(-1);
+
+	memset(&im->runs[im->run_count], 0, sizeof(struct slrdata_import_run));
+	im->runs[im->run_count].first = im->file_pairs;
+	im->runs[im->run_count].end = im->file_pairs + im->pair_count;
+	im->run_count++;
+	im->file_pairs += im->pair_count;
+	im->pair_count = 0;
 
 	return(0);
 }
 
-int slrdata_create_relation_file(slrdata_t *d, const char *restrict foldername, const char *restrict relationname)
+static int slrdata_import_tuple(struct slrdata_import *im, const uint_fast64_t *tuple)
 {
-	uint_fast64_t size = SLRDATA_RELATION_HEADERSIZE_BASIC;
-	unsigned char data[size];
+	for (uint_fast64_t j = 0; j < im->arity; j++)
+	{
+		if (tuple[j] >= ((uint_fast64_t)1 << 48))
+			return(-1);
 
-	slrdata_headerinit(data, size, true);
+		if (tuple[j] >= im->element_count)
+			im->element_count = tuple[j] + 1;
 
-	if(slrdata_create_and_write_file(d, slrdata_filepath(foldername, relationname), data, size))
-	{
-		return(-1);
-	}
+		if (im->pair_count == im->pair_capacity && slrdata_import_flush(im))
+			return(-1);
 
-	slrdata_resize(d, size + 8 + 8 + 6, true);
+		im->pairs[im->pair_count].element = tuple[j];
+		im->pairs[im->pair_count].tuple = im->tuple_count;
+		im->pair_count++;
+	}
 
-	slrdata_write(8, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC, 0);
-	slrdata_write(8, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 8, 0);
-	// TODO arity
-	slrdata_write(6, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 16, 0);
+	if (slrdata_builder_add(&im->builder, tuple))
+		return(-1);
 
-	d->foldername = foldername;
-	d->filename = relationname;
+	im->tuple_count++;
 
 	return(0);
 }
 
-// add element to element file
-int slrdata_add_element(slrdata_t *d, const char *restrict label)
+static int slrdata_import_text(struct slrdata_import *im, FILE *in)
 {
-	// TODO reduce code and check it is the element file
-	uint_fast64_t element_list_offset = slrdata_read(8, d->ptr + SLRDATA_HEADERSIZE_BASIC);
-	if (element_list_offset == 0)
+	char *line = NULL;
+	size_t line_capacity = 0;
+	uint_fast64_t *tuple = NULL;
+	uint_fast64_t tuple_capacity = 0;
+	int ret = 0;
+
+	while (getline(&line, &line_capacity, in) != -1)
 	{
-		// update element list offset
-		slrdata_write(8, d->ptr + SLRDATA_HEADERSIZE_BASIC, SLRDATA_MAIN_HEADERSIZE);
+		char *p = line;
+		uint_fast64_t count = 0;
 
-		// resize
-		slrdata_resize(d, d->size + SLRDATA_MAIN_LISTHEADERSIZE + SLRDATA_MAIN_ELEMENTSIZE, false);
+		if (*p == '#')
+			continue;
 
-		// add element list header
-		slrdata_write(6, d->ptr + SLRDATA_MAIN_HEADERSIZE, SLRDATA_MAIN_ELEMENTSIZE);
-		slrdata_write(6, d->ptr + SLRDATA_MAIN_HEADERSIZE + 6, 1);
+		for (;;)
+		{
+			// skip separators, a delimiter separates exactly two fields
+			if (im->options->delimiter == 0)
+				while (*p == ' ' || *p == '\t' || *p == '\r')
+					p++;
 
-		// add element
-		// TODO label
-		slrdata_write(6, d->ptr + SLRDATA_MAIN_HEADERSIZE + SLRDATA_MAIN_LISTHEADERSIZE, 1);
-	}
-	else
-	{
-		uint_fast64_t list_size = slrdata_read(6, d->ptr + element_list_offset);
-		uint_fast64_t element_count = slrdata_read(6, d->ptr + element_list_offset + 6);
+			if (*p == '\n' || *p == '\0')
+				break;
 
-		// update element list header
-		slrdata_write(6, d->ptr + element_list_offset, list_size + SLRDATA_MAIN_ELEMENTSIZE);
-		slrdata_write(6, d->ptr + element_list_offset + 6, element_count + 1);
+			char *end = p;
+			while (*end != '\n' && *end != '\0' && *end != '\r'
+					&& (im->options->delimiter ? *end != im->options->delimiter : (*end != ' ' && *end != '\t')))
+				end++;
 
-		// TODO label
-		// resize
-		slrdata_resize(d, d->size + SLRDATA_MAIN_ELEMENTSIZE, false);
+			if (count == tuple_capacity)
+			{
+				tuple_capacity = tuple_capacity ? 2 * tuple_capacity : 8;
+				uint_fast64_t *grown = realloc(tuple, tuple_capacity * sizeof(uint_fast64_t));
+				if (grown == NULL)
+				{
+					ret = -1;
+					goto done;
+				}
+				tuple = grown;
+			}
+
+			if (im->options->labels)
+			{
+				tuple[count] = slrdata_import_label(im, p, end - p);
+			}
+			else
+			{
+				char *parsed;
+				tuple[count] = strtoull(p, &parsed, 10);
+				if (parsed != end || end == p)
+				{
+					ret = -1;
+					goto done;
+				}
+			}
+			count++;
+
+			p = end;
+			if (im->options->delimiter && *p == im->options->delimiter)
+				p++;
+		}
+
+		// blank line
+		if (count == 0)
+			continue;
 
-		// add element
-		slrdata_write(6, d->ptr + SLRDATA_MAIN_HEADERSIZE + SLRDATA_MAIN_LISTHEADERSIZE + list_size, element_count + 1);
+		if (im->arity == 0)
+		{
+			im->arity = count;
+			if (slrdata_builder_init(&im->builder, im->builder.relation, im->arity))
+			{
+				ret = -1;
+				goto done;
+			}
+		}
+
+		if (count != im->arity || slrdata_import_tuple(im, tuple))
+		{
+			ret = -1;
+			goto done;
+		}
 	}
 
-	return(0);
+	if (ferror(in))
+		ret = -1;
+
+done:
+	free(line);
+	free(tuple);
+
+	return(ret);
 }
 
-int slrdata_add_tuple(slrdata_t *d, uint_fast64_t * tuple, uint_fast64_t arity)
+static int slrdata_import_binary(struct slrdata_import *im, FILE *in)
 {
-	// TODO reduce code
-	uint_fast64_t tuple_list_offset = slrdata_read(8, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC);
-	if (tuple_list_offset == 0)
+	unsigned char buffer[im->arity * 8];
+	uint_fast64_t tuple[im->arity];
+	size_t n;
+
+	while ((n = fread(buffer, 8, im->arity, in)) == im->arity)
 	{
-		tuple_list_offset = SLRDATA_RELATION_HEADERSIZE;
-		// TODO assumes there is no list of elements
-		// update tuple list offset and arity
-		slrdata_write(8, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC, tuple_list_offset);
-		slrdata_write(8, d->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 16, arity);
+		for (uint_fast64_t j = 0; j < im->arity; j++)
+			tuple[j] = slrdata_read(8, buffer + 8 * j);
 
-		// resize
-		slrdata_resize(d, d->size + SLRDATA_RELATION_LISTHEADERSIZE + (SLRDATA_RELATION_TUPLEELEMENTSIZE * arity), true);
+		if (slrdata_import_tuple(im, tuple))
+			return(-1);
+	}
 
-		// add tuple list header
-		slrdata_write(6, d->ptr + tuple_list_offset, (SLRDATA_RELATION_TUPLEELEMENTSIZE * arity));
-		slrdata_write(6, d->ptr + tuple_list_offset + 6, 1);
+	// a partial tuple at the end is an error
+	return (n == 0 && !ferror(in)) ? 0 : -1;
+}
 
-		// add tuple
-		for(int i = 0; i < arity; i++)
-			slrdata_write(6, d->ptr + tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (i * SLRDATA_RELATION_TUPLEELEMENTSIZE), tuple[i]);
-	}
-	else
+// Next pair of a run, refilling its buffer from fd. Returns 0 once the run is
+// exhausted and -1 if it cannot be read.
+static int slrdata_import_run_next(struct slrdata_import_run *run, int fd, struct slrdata_import_pair *pair)
+{
+	if (run->next == run->count)
 	{
-		uint_fast64_t list_size = slrdata_read(6, d->ptr + tuple_list_offset);
-		uint_fast64_t tuple_count = slrdata_read(6, d->ptr + tuple_list_offset + 6);
+		if (run->first == run->end)
+			return(0);
 
-		// update tuple list header
-		slrdata_write(6, d->ptr + tuple_list_offset, list_size + (arity * SLRDATA_RELATION_TUPLEELEMENTSIZE));
-		slrdata_write(6, d->ptr + tuple_list_offset + 6, tuple_count + 1);
+		size_t count = run->end - run->first < run->capacity ? run->end - run->first : run->capacity;
+		size_t size = count * sizeof(struct slrdata_import_pair);
+		if (pread(fd, run->buffer, size, run->first * sizeof(struct slrdata_import_pair)) != (ssize_t)size)
+			return(-1);
 
-		// resize
-		slrdata_resize(d, d->size + (arity * SLRDATA_RELATION_TUPLEELEMENTSIZE), true);
+		run->first += count;
+		run->count = count;
+		run->next = 0;
+	}
+
+	*pair = run->buffer[run->next++];
+	return(1);
+}
+
+// Give the file runs among the k runs read buffers splitting the memory of
+// the import between them and the merge output
+static int slrdata_import_buffers(struct slrdata_import *im, struct slrdata_import_run *runs, size_t k)
+{
+	size_t capacity = im->pair_capacity / (k + 1) > SLRDATA_IMPORT_MIN_BUFFER ? im->pair_capacity / (k + 1) : SLRDATA_IMPORT_MIN_BUFFER;
 
-		// add tuple
-		for(int i = 0; i < arity; i++)
-					slrdata_write(6, d->ptr + tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + list_size + (i * SLRDATA_RELATION_TUPLEELEMENTSIZE), tuple[i]);
+	for (size_t r = 0; r < k; r++)
+	{
+		if (runs[r].first == runs[r].end || runs[r].buffer)
+			continue;
+
+		if ((runs[r].buffer = malloc(capacity * sizeof(struct slrdata_import_pair))) == NULL)
+			return(-1);
+
+		runs[r].capacity = capacity;
 	}
 
 	return(0);
 }
 
-int slrdata_add_incidence_lists(slrdata_t *relation, slrdata_t *elements, uint_fast64_t norm_degree, uint_fast64_t max_degree)
+// Move the run top of the heap to its next pair, or drop it if it has none
+static int slrdata_import_merge_pop(struct slrdata_import_merge *m, int fd)
 {
-	uint_fast64_t element_count = slrdata_element_count(elements);
-	uint_fast64_t arity = slrdata_arity(relation);
-	uint_fast64_t element_list_offset = relation->size;
-	uint_fast64_t tuple_count = slrdata_tuple_count(relation);
+	size_t r = m->heap[0];
+	int next = slrdata_import_run_next(&m->runs[r], fd, &m->current[r]);
+	if (next == -1)
+		return(-1);
 
-	// update element list offset
-	slrdata_write(8, relation->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 8, element_list_offset);
+	if (next == 0)
+		r = m->heap[--m->size];
 
-	// resize
-	uint_fast64_t new_size = relation->size + SLRDATA_RELATION_LISTHEADERSIZE + element_count * (SLRDATA_RELATION_ELEMENTSIZE);
-	slrdata_resize(relation, new_size, true);
+	// sift down
+	size_t i = 0;
+	for (;;)
+	{
+		size_t child = 2 * i + 1;
+		if (child >= m->size)
+			break;
+		if (child + 1 < m->size && slrdata_import_compare(&m->current[m->heap[child + 1]], &m->current[m->heap[child]]) < 0)
+			child++;
+		if (slrdata_import_compare(&m->current[m->heap[child]], &m->current[r]) >= 0)
+			break;
+		m->heap[i] = m->heap[child];
+		i = child;
+	}
+	if (m->size > 0)
+		m->heap[i] = r;
 
-	// element list header
-	uint_fast64_t list_size = element_count * SLRDATA_RELATION_ELEMENTSIZE;
-	slrdata_write(6, relation->ptr + element_list_offset, list_size);
-	slrdata_write(6, relation->ptr + element_list_offset + 6, element_count);
+	return(0);
+}
 
-	// element and incidence lists
-	for(uint_fast64_t i = 0; i < element_count; i++)
+static int slrdata_import_merge_begin(struct slrdata_import_merge *m, struct slrdata_import_run *runs, size_t k, int fd)
+{
+	m->runs = runs;
+	m->size = 0;
+	m->heap = malloc((k ? k : 1) * sizeof(size_t));
+	m->current = malloc((k ? k : 1) * sizeof(struct slrdata_import_pair));
+	if (m->heap == NULL || m->current == NULL)
+		return(-1);
+
+	for (size_t r = 0; r < k; r++)
 	{
-		uint_fast64_t element_offset = element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (i * SLRDATA_RELATION_ELEMENTSIZE);
+		int next = slrdata_import_run_next(&runs[r], fd, &m->current[r]);
+		if (next == -1)
+			return(-1);
+		if (next == 0)
+			continue;
 
-		slrdata_write(8, relation->ptr + element_offset, relation->size);
-		slrdata_resize(relation, relation->size + SLRDATA_RELATION_LISTHEADERSIZE + (norm_degree * SLRDATA_RELATION_INCIDENCESIZE), true);
+		size_t i = m->size++;
+		for (; i > 0 && slrdata_import_compare(&m->current[r], &m->current[m->heap[(i - 1) / 2]]) < 0; i = (i - 1) / 2)
+			m->heap[i] = m->heap[(i - 1) / 2];
+		m->heap[i] = r;
+	}
 
-		// incidence list offset
-		uint_fast64_t incidence_list_offset = slrdata_read(8, relation->ptr + element_offset);
-		slrdata_write(8, relation->ptr + element_offset, incidence_list_offset);
+	return(0);
+}
 
-		// incidence list header
-		slrdata_write(6, relation->ptr + incidence_list_offset, norm_degree * SLRDATA_RELATION_INCIDENCESIZE);
-		slrdata_write(6, relation->ptr + incidence_list_offset + 6, 0);
-	}
+static void slrdata_import_merge_end(struct slrdata_import_merge *m)
+{
+	free(m->heap);
+	free(m->current);
+	m->heap = NULL;
+	m->current = NULL;
+}
 
-	for(uint_fast64_t i = 0; i < tuple_count; i++)
+// Merge groups of SLRDATA_IMPORT_FANIN runs into single runs of a new run file
+// until at most SLRDATA_IMPORT_FANIN are left, so that the final merge reads
+// from a bounded number of buffers
+static int slrdata_import_reduce_runs(struct slrdata_import *im)
+{
+	while (im->run_count > SLRDATA_IMPORT_FANIN)
 	{
-		uint_fast64_t *tuple;
-		tuple = slrdata_ith_tuple(relation, i);
+		int fd = slrdata_import_tempfile(im);
+		size_t count = (im->run_count + SLRDATA_IMPORT_FANIN - 1) / SLRDATA_IMPORT_FANIN;
+		struct slrdata_import_run *runs = calloc(count, sizeof(struct slrdata_import_run));
+		size_t capacity = im->pair_capacity / (SLRDATA_IMPORT_FANIN + 1) > SLRDATA_IMPORT_MIN_BUFFER ? im->pair_capacity / (SLRDATA_IMPORT_FANIN + 1) : SLRDATA_IMPORT_MIN_BUFFER;
+		struct slrdata_import_pair *out = malloc(capacity * sizeof(struct slrdata_import_pair));
+		uint64_t written = 0;
+		int ret = fd == -1 || runs == NULL || out == NULL ? -1 : 0;
 
-		for(int a = 0; a < arity; a++)
+		for (size_t g = 0; ret == 0 && g < count; g++)
 		{
-			uint_fast64_t element_offset = element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (tuple[a] * SLRDATA_RELATION_ELEMENTSIZE);
-			uint_fast64_t element_incidence_list_offset = slrdata_read(8, relation->ptr + element_offset);
-			uint_fast64_t old_degree = slrdata_read(6, relation->ptr + element_incidence_list_offset + 6);
-			uint_fast64_t current_list_size = slrdata_read(6, relation->ptr + element_incidence_list_offset);
+			struct slrdata_import_run *group = im->runs + g * SLRDATA_IMPORT_FANIN;
+			size_t k = im->run_count - g * SLRDATA_IMPORT_FANIN < SLRDATA_IMPORT_FANIN ? im->run_count - g * SLRDATA_IMPORT_FANIN : SLRDATA_IMPORT_FANIN;
+			struct slrdata_import_merge m = { 0 };
+			size_t n = 0;
 
-			if(old_degree + 1 > max_degree)
+			runs[g].first = written;
+			ret = slrdata_import_buffers(im, group, k) || slrdata_import_merge_begin(&m, group, k, im->fd) ? -1 : 0;
+			while (ret == 0 && m.size > 0)
 			{
-				return(-1);
+				out[n++] = m.current[m.heap[0]];
+				if (n == capacity)
+				{
+					ret = slrdata_import_write(fd, written, out, n);
+					written += n;
+					n = 0;
+				}
+				if (ret == 0)
+					ret = slrdata_import_merge_pop(&m, im->fd);
 			}
+			if (ret == 0 && n)
+				ret = slrdata_import_write(fd, written, out, n);
+			written += n;
+			runs[g].end = written;
 
-			if((old_degree + 1) * SLRDATA_RELATION_INCIDENCESIZE  > current_list_size)
+			slrdata_import_merge_end(&m);
+			for (size_t r = 0; r < k; r++)
 			{
-				// incidence list offset
-				slrdata_write(8, relation->ptr + element_offset, relation->size);
-				slrdata_resize(relation, relation->size + SLRDATA_RELATION_LISTHEADERSIZE + (norm_degree * SLRDATA_RELATION_INCIDENCESIZE), true);
-
-				// header
-				uint_fast64_t new_incidence_list_offset = slrdata_read(8, relation->ptr + element_offset);
-				memcpy(relation->ptr + new_incidence_list_offset, relation->ptr + element_incidence_list_offset, SLRDATA_RELATION_LISTHEADERSIZE + (old_degree * SLRDATA_RELATION_INCIDENCESIZE));
-				slrdata_write(6, relation->ptr + new_incidence_list_offset, current_list_size + (norm_degree * SLRDATA_RELATION_INCIDENCESIZE));
-				slrdata_write(6, relation->ptr + new_incidence_list_offset + 6, old_degree + 1);
-
-				slrdata_write(6, relation->ptr + new_incidence_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (old_degree * SLRDATA_RELATION_INCIDENCESIZE), i);
-			}
-			else{
-				// update degree
-				slrdata_write(6, relation->ptr + element_incidence_list_offset + 6, old_degree + 1);
-				// add tuple index
-				slrdata_write(6, relation->ptr + element_incidence_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (old_degree * SLRDATA_RELATION_INCIDENCESIZE), i);
+				free(group[r].buffer);
+				group[r].buffer = NULL;
 			}
 		}
+
+		free(out);
+		if (ret)
+		{
+			if (fd != -1)
+				close(fd);
+			free(runs);
+			return(-1);
+		}
+
+		close(im->fd);
+		free(im->runs);
+		im->fd = fd;
+		im->file_pairs = written;
+		im->runs = runs;
+		im->run_count = count;
 	}
 
 	return(0);
 }
 
-// reduce size by removing unneeded space between incidence lists
-int slrdata_reduce_size(slrdata_t *rel)
+// k-way merge of the runs straight into the incidence lists of the relation
+static int slrdata_import_incidence_lists(struct slrdata_import *im, slrdata_t *relation)
 {
-	slrdata_t rel_new;
-	char * filenamedup = strdup(rel->filename);
-	if(slrdata_create_relation_file(&rel_new, (const char *restrict)rel->foldername, strcat(filenamedup, "copy")))
-		return -1;
-
-	uint_fast64_t tuple_count = slrdata_tuple_count(rel);
-	uint_fast64_t arity = slrdata_arity(rel);
-	uint_fast64_t tuple_list_size = SLRDATA_RELATION_LISTHEADERSIZE + tuple_count * (arity * SLRDATA_RELATION_TUPLEELEMENTSIZE);
-	uint_fast64_t element_count = slrdata_element_count(rel);
-	uint_fast64_t element_list_size = SLRDATA_RELATION_LISTHEADERSIZE + (element_count * SLRDATA_RELATION_ELEMENTSIZE);
-
-	// resize
-	if(slrdata_resize(&rel_new, rel_new.size + tuple_list_size + element_list_size, true))
-		return -1;
+	uint_fast64_t n = im->element_count;
+	uint_fast8_t width = relation->width;
+	uint_fast64_t element_list_offset = slrdata_list_align(width, relation->size);
+	uint_fast64_t incidence_lists_offset = slrdata_list_align(width, element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + n * SLRDATA_RELATION_ELEMENTSIZE);
+	uint_fast64_t new_size = incidence_lists_offset + n * slrdata_list_stride(width, 0) + im->tuple_count * im->arity * width;
+	struct slrdata_import_merge m = { 0 };
+	int ret = -1;
 
-	// update arity
-	slrdata_write(6, rel_new.ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 16, arity);
-
-	// copy tuple list
-	uint_fast64_t old_tuple_list_offset = slrdata_read(8, rel->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC);
-	slrdata_write(8, rel_new.ptr + SLRDATA_RELATION_HEADERSIZE_BASIC, SLRDATA_RELATION_HEADERSIZE);
-	memcpy(rel_new.ptr + SLRDATA_RELATION_HEADERSIZE, rel->ptr + old_tuple_list_offset, tuple_list_size);
+	if (slrdata_import_reduce_runs(im) || slrdata_resize(relation, new_size, true))
+		return(-1);
 
-	// add element list offset
-	uint_fast64_t new_element_list_offset = SLRDATA_RELATION_HEADERSIZE + tuple_list_size;
-	slrdata_write(8, rel_new.ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 8, new_element_list_offset);
+	// element list header
+	slrdata_write(6, relation->ptr + element_list_offset, n * SLRDATA_RELATION_ELEMENTSIZE);
+	slrdata_write(6, relation->ptr + element_list_offset + 6, n);
 
-	// copy element list header
-	slrdata_write(6, rel_new.ptr + new_element_list_offset, element_count * SLRDATA_RELATION_ELEMENTSIZE);
-	slrdata_write(6, rel_new.ptr + new_element_list_offset + 6, element_count);
+	if (slrdata_import_buffers(im, im->runs, im->run_count) || slrdata_import_merge_begin(&m, im->runs, im->run_count, im->fd))
+		goto done;
 
-	// copy incidence lists
-	uint_fast64_t old_element_list_offset = slrdata_read(8, rel->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 8);
-	uint_fast64_t current_offset = new_element_list_offset + element_list_size;
-	for(uint_fast64_t i = 0; i < element_count; i++)
+	unsigned char *element_list = relation->ptr + element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE;
+	uint_fast64_t incidence_list_offset = incidence_lists_offset;
+	for (uint_fast64_t e = 0; e < n; e++)
 	{
-		// update incidence list offset
-		slrdata_write(8, rel_new.ptr + new_element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (i * SLRDATA_RELATION_ELEMENTSIZE), current_offset);
+		unsigned char *incidence_list = relation->ptr + incidence_list_offset;
+		uint_fast64_t degree = 0;
 
-		// add incidence list header
-		uint_fast64_t degree = slrdata_degree(rel, i);
+		while (m.size > 0 && m.current[m.heap[0]].element == e)
+		{
+			slrdata_set(width, incidence_list + SLRDATA_RELATION_LISTHEADERSIZE, degree, m.current[m.heap[0]].tuple);
+			degree++;
 
-		if(slrdata_resize(&rel_new, rel_new.size + SLRDATA_RELATION_LISTHEADERSIZE + (degree * SLRDATA_RELATION_INCIDENCESIZE), true))
-				return -1;
+			if (slrdata_import_merge_pop(&m, im->fd))
+				goto done;
+		}
 
-		uint_fast64_t old_incidence_list_offset = slrdata_read(8, rel->ptr + old_element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (i * SLRDATA_RELATION_ELEMENTSIZE));
-		slrdata_write(6, rel_new.ptr + current_offset, degree * SLRDATA_RELATION_INCIDENCESIZE);
-		slrdata_write(6, rel_new.ptr + current_offset + 6, degree);
+		if (im->options->max_degree && degree > im->options->max_degree)
+			goto done;
 
-		// copy incidence list
-		memcpy(rel_new.ptr + current_offset + 12, rel->ptr + old_incidence_list_offset + 12, degree * SLRDATA_RELATION_INCIDENCESIZE);
+		slrdata_write(8, element_list + e * SLRDATA_RELATION_ELEMENTSIZE, incidence_list_offset);
+		slrdata_write(6, incidence_list, degree * width);
+		slrdata_write(6, incidence_list + 6, degree);
 
-		current_offset += SLRDATA_RELATION_LISTHEADERSIZE + degree * SLRDATA_RELATION_INCIDENCESIZE;
+		incidence_list_offset += slrdata_list_stride(width, degree * width);
 	}
 
-	if(slrdata_resize(&rel_new, current_offset, true))
-		return -1;
-
-	if(remove(slrdata_filepath(rel->foldername, rel->filename)))
-		return -1;
+	// update element list offset
+	slrdata_write(8, relation->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 8, element_list_offset);
+	if (slrdata_resize(relation, incidence_list_offset, true))
+		goto done;
 
-	if(rename(slrdata_filepath(rel_new.foldername, rel_new.filename), slrdata_filepath(rel->foldername, rel->filename)))
-			return -1;
+	ret = slrdata_trim(relation);
 
-	rel = &rel_new;
+done:
+	slrdata_import_merge_end(&m);
 
-	return 0;
+	return(ret);
 }
 
-uint_fast64_t slrdata_arity(slrdata_t *relation)
+// Import a relation from a stream of tuples into a new relation file in the
+// folder, creating the folder and the element file as needed. Text input has
+// one tuple per line, binary input arity little endian 64 bit element ids per
+// tuple. The tuple list is written as the input is read; the incidence lists
+// are built by an external sort of (element, tuple) pairs using about
+// options->memory bytes, with sorted runs kept in an unlinked temporary file
+// in the folder and merged SLRDATA_IMPORT_FANIN at a time. The element file is
+// grown to the largest element id seen, or with labels, gets an element for
+// every label it does not have yet, and the relation is added to its catalog.
+// A failed import removes the relation file and the elements it added to the
+// element file.
+int slrdata_import(FILE *in, const char *restrict foldername, const char *restrict relationname, const struct slrdata_import_options *options)
 {
-	return slrdata_read(6, relation->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + (2 * 8));
-}
+	struct slrdata_import im;
+	slrdata_t relation, elements;
+	int ret = -1;
 
-uint_fast64_t slrdata_degree(slrdata_t *relation, uint_fast64_t e)
-{
-	uint_fast64_t element_list_offset = slrdata_read(8, relation->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 8);
-	uint_fast64_t incidence_list_offset = slrdata_read(8, relation->ptr + element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (e * SLRDATA_RELATION_ELEMENTSIZE));
+	memset(&im, 0, sizeof(im));
+	im.fd = -1;
+	im.options = options;
+	im.foldername = foldername;
+	im.arity = options->arity;
+	im.pair_capacity = options->memory / sizeof(struct slrdata_import_pair);
+	if (im.pair_capacity < 1024)
+		im.pair_capacity = 1024;
 
-	return slrdata_read(6, relation->ptr + incidence_list_offset + 6);
-}
+	if ((options->binary && options->arity == 0) || (options->binary && options->labels))
+		return(-1);
 
-// TODO rename. i and e start at 0
-uint_fast64_t * slrdata_tuple(slrdata_t *relation, uint_fast64_t e, uint_fast64_t i)
-{
-	uint_fast64_t arity = slrdata_arity(relation);
-	static uint_fast64_t* tuple;
-	tuple = (uint_fast64_t*)malloc(arity * sizeof(uint_fast64_t));
+	im.pairs = malloc(im.pair_capacity * sizeof(struct slrdata_import_pair));
+	if (im.pairs == NULL)
+		return(-1);
+
+	// the folder may already exist
+	slrdata_create_directory(foldername);
+
+	// labels are looked up in and added to the element file as they are read
+	if (slrdata_open(&elements, foldername, "elements", false, false)
+			&& slrdata_create_element_file(&elements, foldername))
+		goto done;
+	im.elements = &elements;
+	uint_fast64_t first_element = elements.element_count;
+
+	if (slrdata_create_relation_file(&relation, foldername, relationname))
+		goto close_elements;
+
+	im.builder.relation = &relation;
+	if (im.arity && slrdata_builder_init(&im.builder, &relation, im.arity))
+		goto close_relation;
+
+	if ((options->binary ? slrdata_import_binary(&im, in) : slrdata_import_text(&im, in)) || im.arity == 0)
+		goto close_relation;
 
-	uint_fast64_t degree = slrdata_degree(relation, e);
-	if (degree <= i)
+	if (slrdata_builder_finish(&im.builder))
+		goto close_relation;
+
+	if (im.element_count > elements.element_count
+			&& slrdata_add_elements(&elements, NULL, im.element_count - elements.element_count))
+		goto close_relation;
+	im.element_count = elements.element_count;
+
+	// incidence lists, all pairs fit in memory if no run was written
+	if (im.run_count == 0)
 	{
-		return NULL;
+		qsort(im.pairs, im.pair_count, sizeof(struct slrdata_import_pair), slrdata_import_compare);
+
+		struct slrdata_import_run *run = calloc(1, sizeof(struct slrdata_import_run));
+		if (run == NULL)
+			goto close_relation;
+
+		run->buffer = im.pairs;
+		run->count = im.pair_count;
+		im.runs = run;
+		im.run_count = 1;
+		im.pairs = NULL;
 	}
+	else
+	{
+		if (im.pair_count && slrdata_import_flush(&im))
+			goto close_relation;
 
-	uint_fast64_t element_list_offset = slrdata_read(8, relation->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC + 8);
-	uint_fast64_t incidence_list_offset = slrdata_read(8, relation->ptr + element_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (e * SLRDATA_RELATION_ELEMENTSIZE));
-	uint_fast64_t tuple_index = slrdata_read(6, relation->ptr + incidence_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (i * SLRDATA_RELATION_INCIDENCESIZE));
+		free(im.pairs);
+		im.pairs = NULL;
+	}
 
-	uint_fast64_t tuple_list_offset = slrdata_read(8, relation->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC);
-	uint_fast64_t tuple_offset = tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (tuple_index * SLRDATA_RELATION_TUPLEELEMENTSIZE * arity);
+	ret = slrdata_import_incidence_lists(&im, &relation);
+	if (ret == 0)
+		ret = slrdata_add_relation(&elements, &relation);
 
-	for (uint_fast64_t j = 0; j < arity; j++)
+close_relation:
+	slrdata_close(&relation);
+	if (ret)
 	{
-		tuple[j] = slrdata_read(6, relation->ptr + tuple_offset + (j * SLRDATA_RELATION_TUPLEELEMENTSIZE));
+		char *path = slrdata_filepath(foldername, relationname);
+		unlink(path);
+		free(path);
 	}
 
-	return tuple;
+close_elements:
+	if (ret)
+		slrdata_drop_elements(&elements, first_element);
+	slrdata_close(&elements);
+
+done:
+	for (size_t r = 0; r < im.run_count; r++)
+		free(im.runs[r].buffer);
+	if (im.fd != -1)
+		close(im.fd);
+	free(im.runs);
+	free(im.pairs);
+
+	return(ret);
 }
 
-uint_fast64_t * slrdata_ith_tuple(slrdata_t *relation, uint_fast64_t i)
+// Add tuples to a relation whose incidence lists are already built, without
+// rebuilding them. The tuples go to the delta segment, a "tupdelta" section
+// with the number of tuples and incidences, the tuples as 8 byte fields and
+// (element, tuple) pairs sorted by element. The tuples get the indices after
+// the tuple list and all queries include them. Elements may be new elements
+// of the element file. The segment grows in place while it is the last
+// section; slrdata_merge_delta folds it into the lists.
+int slrdata_add_delta_tuples(slrdata_t *relation, const uint_fast64_t *tuples, uint_fast64_t count, uint_fast64_t arity)
 {
-	uint_fast64_t arity = slrdata_arity(relation);
-	static uint_fast64_t* tuple;
-	tuple = (uint_fast64_t*)malloc(arity * sizeof(uint_fast64_t));
+	if (relation->readonly || relation->element_list == NULL || relation->version < 2 || arity != relation->arity)
+		return(-1);
+
+	if (count == 0)
+		return(0);
+
+	uint_fast64_t old_count = relation->delta_count;
+	if (!slrdata_fits(relation->width, relation->tuple_count + old_count + count - 1))
+		return(-1);
+	for (uint_fast64_t i = 0; i < count * arity; i++)
+		if (!slrdata_fits(relation->width, tuples[i]))
+			return(-1);
+
+	uint_fast64_t old_incidences = slrdata_delta_incidence_count(relation);
+	uint_fast64_t new_incidences = count * arity;
+	struct slrdata_import_pair *pairs = malloc((new_incidences ? new_incidences : 1) * sizeof(struct slrdata_import_pair));
+	if (pairs == NULL)
+		return(-1);
 
-	uint_fast64_t tuple_count = slrdata_tuple_count(relation);
-	if (tuple_count <= i)
+	for (uint_fast64_t j = 0; j < count; j++)
 	{
-		return NULL;
+		for (uint_fast64_t a = 0; a < arity; a++)
+		{
+			pairs[j * arity + a].element = tuples[j * arity + a];
+			pairs[j * arity + a].tuple = relation->tuple_count + old_count + j;
+		}
 	}
+	qsort(pairs, new_incidences, sizeof(struct slrdata_import_pair), slrdata_import_compare);
 
-	uint_fast64_t tuple_list_offset = slrdata_read(8, relation->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC);
-	uint_fast64_t tuple_offset = tuple_list_offset + SLRDATA_RELATION_LISTHEADERSIZE + (i * SLRDATA_RELATION_TUPLEELEMENTSIZE * arity);
+	uint_fast64_t tuples_size = (old_count + count) * arity * 8;
+	uint_fast64_t offset = slrdata_extend_section(relation, "tupdelta", SLRDATA_DELTA_HEADERSIZE + tuples_size + (old_incidences + new_incidences) * SLRDATA_DELTA_INCIDENCESIZE);
+	if (offset == 0)
+	{
+		free(pairs);
+		return(-1);
+	}
+	unsigned char *delta = relation->ptr + offset;
 
-	for (uint_fast64_t j = 0; j < arity; j++)
+	// make room for the new tuples before the pairs
+	unsigned char *incidences = delta + SLRDATA_DELTA_HEADERSIZE + tuples_size;
+	memmove(incidences, delta + SLRDATA_DELTA_HEADERSIZE + old_count * arity * 8, old_incidences * SLRDATA_DELTA_INCIDENCESIZE);
+	for (uint_fast64_t i = 0; i < count * arity; i++)
+		slrdata_write(8, delta + SLRDATA_DELTA_HEADERSIZE + old_count * arity * 8 + i * 8, tuples[i]);
+
+	// merge the new pairs from the back, the new tuples come after all old ones
+	uint_fast64_t i = old_incidences, j = new_incidences, k = old_incidences + new_incidences;
+	while (j > 0)
 	{
-		tuple[j] = slrdata_read(6, relation->ptr + tuple_offset + (j * SLRDATA_RELATION_TUPLEELEMENTSIZE));
+		k--;
+		if (i > 0 && slrdata_read(8, incidences + (i - 1) * SLRDATA_DELTA_INCIDENCESIZE) > pairs[j - 1].element)
+		{
+			i--;
+			memmove(incidences + k * SLRDATA_DELTA_INCIDENCESIZE, incidences + i * SLRDATA_DELTA_INCIDENCESIZE, SLRDATA_DELTA_INCIDENCESIZE);
+		}
+		else
+		{
+			j--;
+			slrdata_write(8, incidences + k * SLRDATA_DELTA_INCIDENCESIZE, pairs[j].element);
+			slrdata_write(8, incidences + k * SLRDATA_DELTA_INCIDENCESIZE + 8, pairs[j].tuple);
+		}
 	}
+	free(pairs);
 
-	return tuple;
+	slrdata_write(8, delta, old_count + count);
+	slrdata_write(8, delta + 8, old_incidences + new_incidences);
+	slrdata_refresh(relation);
+
+	return(0);
 }
 
-uint_fast64_t slrdata_element_count(slrdata_t *d)
+// Rebuild the relation with the tuples of the delta segment appended to the
+// tuple list, so that they are in the incidence lists again. The layout is
+// kept, and the degree table, hash index, sort order and compression are
+// redone if the relation had them. The incidence lists are built with the same
+// max_degree bound as slrdata_build_incidence_lists, which the file does not
+// record: pass the bound the relation was built with, or -1. The merge fails,
+// leaving the relation as it was, if an element exceeds it. The new file
+// replaces the old one under its name and the handle is moved to it.
+int slrdata_merge_delta(slrdata_t *relation, slrdata_t *elements, uint_fast64_t max_degree)
 {
-	uint_fast64_t element_list_offset_offset = slrdata_is_relation_file(d) ?
-			SLRDATA_RELATION_HEADERSIZE_BASIC + 8 :
-			SLRDATA_HEADERSIZE_BASIC;
+	if (relation->readonly)
+		return(-1);
 
-	uint_fast64_t element_list_offset = slrdata_read(8, d->ptr + element_list_offset_offset);
-	return slrdata_read(6, d->ptr + element_list_offset + 6);
-}
+	if (relation->delta_count == 0)
+		return(0);
 
-uint_fast64_t slrdata_relation_count(slrdata_t *d)
-{
-	if (slrdata_is_relation_file(d))
-			return -1;
+	slrdata_t rel_new;
+	char *copyname = malloc(strlen(relation->filename) + 5);
+	if (copyname == NULL)
+		return(-1);
+	strcat(strcpy(copyname, relation->filename), "copy");
 
-	uint_fast64_t relation_list_offset = slrdata_read(8, d->ptr + SLRDATA_HEADERSIZE_BASIC + 8);
-	return slrdata_read(6, d->ptr + relation_list_offset + 6);
-}
+	if (slrdata_create_relation(&rel_new, relation->foldername, copyname, relation->version, relation->width, relation->columnar ? SLRDATA_LAYOUT_COLUMNAR : 0))
+	{
+		free(copyname);
+		return(-1);
+	}
+	char *copypath = slrdata_filepath(rel_new.foldername, copyname);
 
-uint_fast64_t slrdata_tuple_count(slrdata_t *relation)
-{
-	if (!slrdata_is_relation_file(relation))
-		return -1;
+	uint_fast64_t arity = relation->arity;
+	uint_fast64_t tuple_count = relation->tuple_count + relation->delta_count;
+	uint64_t block[SLRDATA_SCAN_BLOCK];
+	uint_fast64_t per_block = arity ? SLRDATA_SCAN_BLOCK / arity : tuple_count;
+	for (uint_fast64_t first = 0; first < tuple_count; first += per_block)
+	{
+		uint_fast64_t n = slrdata_scan_tuples(relation, first, per_block, block);
+		if (slrdata_add_tuples(&rel_new, block, n, arity))
+			goto fail;
+	}
 
-	uint_fast64_t tuple_list_offset = slrdata_read(8, relation->ptr + SLRDATA_RELATION_HEADERSIZE_BASIC);
+	if (slrdata_build_incidence_lists(&rel_new, elements, max_degree))
+		goto fail;
+
+	if ((relation->compressed && slrdata_compress_incidence_lists(&rel_new))
+			|| (relation->sorted && slrdata_sort_incidence_lists(&rel_new))
+			|| (relation->degree_table && slrdata_add_degree_table(&rel_new))
+			|| (relation->hash_index && slrdata_add_hash_index(&rel_new))
+			|| (relation->neighbors && slrdata_add_neighbor_table(&rel_new, slrdata_read(8, relation->neighbors)))
+			|| slrdata_trim(&rel_new))
+		goto fail;
+
+	// rename replaces the old file in one step
+	char *path = slrdata_filepath(relation->foldername, relation->filename);
+	int renamed = rename(copypath, path);
+	free(path);
+	if (renamed)
+		goto fail;
+
+	memcpy(rel_new.rng, relation->rng, sizeof(relation->rng));
+	rel_new.filename = relation->filename;
+	unsigned hints = relation->hints;
+	rel_new.stats = relation->stats;
+	relation->stats = NULL;
+	slrdata_close(relation);
+	*relation = rel_new;
+	slrdata_advise(relation, hints);
+	free(copypath);
+	free(copyname);
+
+	// keep the catalog entry of the relation current if it has one
+	if (slrdata_catalog_find(elements, relation->filename) != (uint_fast64_t)-1)
+		slrdata_add_relation(elements, relation);
+
+	return(0);
+
+fail:
+	slrdata_close(&rel_new);
+	unlink(copypath);
+	free(copypath);
+	free(copyname);
 
-	return slrdata_read(6, relation->ptr + tuple_list_offset + 6);
+	return(-1);
 }
@@ -0,0 +1,1270 @@
+// Checks of the library against relations kept in memory. Every failed check
+// prints its line and makes the program exit with status 1.
+//
+// slrdata-check folder
+//
+// The folder must not exist; the files of the checks are made in it.
+
+#include "../include/sl-relational-data.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(c) do { if (!(c)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #c); exit(1); } } while (0)
+
+// a relation in memory with the incidence lists of every element in tuple
+// index order, an element that occurs k times in a tuple being listed k times
+struct check_relation
+{
+	uint_fast64_t elements;
+	uint_fast64_t arity;
+	uint_fast64_t count;
+	uint_fast64_t *tuples;
+	uint_fast64_t *first;
+	uint_fast64_t *incidences;
+};
+
+static uint64_t check_rng = 1;
+
+// splitmix64, as in the benchmark
+static uint64_t check_random(void)
+{
+	uint64_t z = (check_rng += 0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+}
+
+// count random tuples over elements elements, with a few repeated elements
+static void check_generate(struct check_relation *r, uint_fast64_t elements, uint_fast64_t arity, uint_fast64_t count)
+{
+	r->elements = elements;
+	r->arity = arity;
+	r->count = count;
+	r->tuples = malloc(count * arity * sizeof(uint_fast64_t));
+	r->first = NULL;
+	r->incidences = NULL;
+
+	for (uint_fast64_t i = 0; i < count * arity; i++)
+	{
+		if (i % arity && check_random() % 16 == 0)
+			r->tuples[i] = r->tuples[i - 1];
+		else
+			r->tuples[i] = check_random() % elements;
+	}
+}
+
+// (re)build the incidence lists of r from its tuples
+static void check_index(struct check_relation *r)
+{
+	free(r->first);
+	free(r->incidences);
+	r->first = calloc(r->elements + 1, sizeof(uint_fast64_t));
+	r->incidences = malloc(r->count * r->arity * sizeof(uint_fast64_t));
+
+	for (uint_fast64_t i = 0; i < r->count * r->arity; i++)
+		r->first[r->tuples[i] + 1]++;
+
+	for (uint_fast64_t e = 0; e < r->elements; e++)
+		r->first[e + 1] += r->first[e];
+
+	uint_fast64_t *next = malloc(r->elements * sizeof(uint_fast64_t));
+	memcpy(next, r->first, r->elements * sizeof(uint_fast64_t));
+	for (uint_fast64_t i = 0; i < r->count * r->arity; i++)
+		r->incidences[next[r->tuples[i]]++] = i / r->arity;
+
+	free(next);
+}
+
+static void check_free(struct check_relation *r)
+{
+	free(r->tuples);
+	free(r->first);
+	free(r->incidences);
+}
+
+static int check_compare(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+// Compare the tuples and incidence lists of rel with r. The incidence lists of
+// a sorted relation are only compared as multisets.
+static void check_relation(slrdata_t *rel, struct check_relation *r, bool sorted)
+{
+	uint_fast64_t tuple[8];
+	uint64_t *buffer = malloc((r->count * r->arity + 1) * sizeof(uint64_t));
+
+	CHECK(slrdata_tuple_count(rel) == r->count);
+	CHECK(slrdata_arity(rel) == r->arity);
+
+	for (uint_fast64_t i = 0; i < r->count; i++)
+	{
+		CHECK(slrdata_read_ith_tuple(rel, i, tuple) == 0);
+		CHECK(memcmp(tuple, r->tuples + i * r->arity, r->arity * sizeof(uint_fast64_t)) == 0);
+	}
+	CHECK(slrdata_read_ith_tuple(rel, r->count, tuple) == -1);
+
+	CHECK(slrdata_scan_tuples(rel, 0, r->count + 1, buffer) == r->count);
+	for (uint_fast64_t i = 0; i < r->count * r->arity; i++)
+		CHECK(buffer[i] == r->tuples[i]);
+
+	for (uint_fast64_t e = 0; e < r->elements; e++)
+	{
+		uint_fast64_t degree = r->first[e + 1] - r->first[e];
+		CHECK(slrdata_degree(rel, e) == degree);
+		CHECK(slrdata_scan_incidences(rel, e, 0, degree + 1, buffer) == degree);
+		if (sorted)
+			qsort(buffer, degree, sizeof(uint64_t), check_compare);
+		for (uint_fast64_t j = 0; j < degree; j++)
+			CHECK(buffer[j] == r->incidences[r->first[e] + j]);
+
+		for (uint_fast64_t j = 0; j < degree; j++)
+		{
+			CHECK(slrdata_read_tuple(rel, e, j, tuple) == 0);
+			bool contains = false;
+			for (uint_fast64_t a = 0; a < r->arity; a++)
+				contains |= tuple[a] == e;
+			CHECK(contains);
+		}
+		CHECK(slrdata_read_tuple(rel, e, degree, tuple) == -1);
+
+		slrdata_cursor_t c;
+		uint_fast64_t n = 0;
+		slrdata_incidence_cursor(rel, e, &c);
+		while (slrdata_cursor_next(&c, tuple))
+			n++;
+		CHECK(n == degree);
+	}
+
+	for (uint_fast64_t i = 0; i < r->count; i += 7)
+	{
+		uint_fast64_t found = slrdata_find_tuple(rel, r->tuples + i * r->arity);
+		CHECK(found < r->count);
+		CHECK(memcmp(r->tuples + found * r->arity, r->tuples + i * r->arity, r->arity * sizeof(uint_fast64_t)) == 0);
+		CHECK(slrdata_has_tuple(rel, r->tuples + i * r->arity));
+	}
+
+	free(buffer);
+}
+
+// other element of the j-th incidence of v in a binary relation
+static uint_fast64_t check_other(slrdata_t *rel, uint_fast64_t v, uint_fast64_t j)
+{
+	uint_fast64_t tuple[2];
+	if (slrdata_read_tuple(rel, v, j, tuple))
+		return -1;
+
+	return tuple[0] == v ? tuple[1] : tuple[0];
+}
+
+static void check_neighbors(slrdata_t *rel, struct check_relation *r)
+{
+	uint64_t buffer[256];
+
+	for (uint_fast64_t v = 0; v < r->elements; v++)
+	{
+		uint_fast64_t degree = slrdata_degree(rel, v);
+		for (uint_fast64_t j = 0; j < degree + 2; j++)
+			CHECK(slrdata_neighbor(rel, v, j) == check_other(rel, v, j));
+
+		uint_fast64_t n = slrdata_scan_neighbors(rel, v, 1, 256, buffer);
+		CHECK(n == (degree > 1 ? degree - 1 : 0));
+		for (uint_fast64_t j = 0; j < n; j++)
+			CHECK(buffer[j] == check_other(rel, v, j + 1));
+	}
+}
+
+static int check_create(slrdata_t *rel, const char *folder, const char *name, int layout, uint_fast64_t elements, uint_fast64_t count)
+{
+	if (layout == 1)
+		return slrdata_create_aligned_relation_file(rel, folder, name, elements, count);
+	if (layout == 2)
+		return slrdata_create_columnar_relation_file(rel, folder, name, elements, count);
+
+	return slrdata_create_relation_file(rel, folder, name);
+}
+
+static int check_folder(char *folder, size_t size, const char *base, const char *name)
+{
+	snprintf(folder, size, "%s/%s", base, name);
+	return slrdata_create_directory(folder);
+}
+
+// length of the file of a handle opened read only, which must be its used size
+static uint_fast64_t check_file_size(slrdata_t *d)
+{
+	char path[4096];
+	snprintf(path, sizeof path, "%s/%s.sld", d->foldername, d->filename);
+
+	FILE *f = fopen(path, "rb");
+	CHECK(f != NULL);
+	CHECK(fseek(f, 0, SEEK_END) == 0);
+	long size = ftell(f);
+	CHECK(fclose(f) == 0);
+
+	return size;
+}
+
+static void check_empty(slrdata_t *rel, uint_fast64_t elements)
+{
+	uint_fast64_t tuple[3];
+
+	CHECK(slrdata_tuple_count(rel) == 0);
+	CHECK(slrdata_read_ith_tuple(rel, 0, tuple) == -1);
+	CHECK(slrdata_sample_tuples(rel, tuple, 1) == -1);
+	for (uint_fast64_t e = 0; e < elements; e++)
+		CHECK(slrdata_degree(rel, e) == 0);
+}
+
+// every layout, with and without compression, survives closing and opening
+static void check_round_trip(const char *base)
+{
+	char folder[4096];
+	CHECK(check_folder(folder, sizeof folder, base, "round-trip") == 0);
+
+	slrdata_t elements, rel;
+	CHECK(slrdata_create_element_file(&elements, folder) == 0);
+	CHECK(slrdata_add_elements(&elements, NULL, 500) == 0);
+
+	const char *names[] = { "packed", "aligned", "columnar" };
+	for (int layout = 0; layout < 3; layout++)
+	{
+		for (uint_fast64_t arity = 2; arity <= 3; arity++)
+		{
+			for (int compressed = 0; compressed < 2; compressed++)
+			{
+				char name[64];
+				snprintf(name, sizeof name, "%s%lu%s", names[layout], (unsigned long)arity, compressed ? "c" : "");
+
+				struct check_relation r;
+				check_generate(&r, 500, arity, 4000);
+				check_index(&r);
+
+				CHECK(check_create(&rel, folder, name, layout, r.elements, r.count) == 0);
+				if (arity == 3)
+				{
+					slrdata_builder_t b;
+					CHECK(slrdata_builder_init(&b, &rel, arity) == 0);
+					for (uint_fast64_t i = 0; i < r.count; i++)
+						CHECK(slrdata_builder_add(&b, r.tuples + i * arity) == 0);
+					CHECK(slrdata_builder_finish(&b) == 0);
+				}
+				else
+				{
+					CHECK(slrdata_add_tuples(&rel, r.tuples, r.count, arity) == 0);
+				}
+
+				CHECK(slrdata_build_incidence_lists(&rel, &elements, -1) == 0);
+				if (compressed)
+					CHECK(slrdata_compress_incidence_lists(&rel) == 0);
+				check_relation(&rel, &r, false);
+				slrdata_close(&rel);
+
+				CHECK(slrdata_open(&rel, folder, name, true, true) == 0);
+				CHECK(check_file_size(&rel) == rel.size);
+				CHECK(rel.compressed == compressed);
+				CHECK(rel.columnar == (layout == 2));
+				check_relation(&rel, &r, false);
+				slrdata_close(&rel);
+
+				check_free(&r);
+			}
+		}
+	}
+
+	// a degree bound below the largest degree fails the build
+	struct check_relation r;
+	check_generate(&r, 500, 2, 4000);
+	CHECK(slrdata_create_relation_file(&rel, folder, "bounded") == 0);
+	CHECK(slrdata_add_tuples(&rel, r.tuples, r.count, 2) == 0);
+	CHECK(slrdata_build_incidence_lists(&rel, &elements, 4) == -1);
+	slrdata_close(&rel);
+	check_free(&r);
+
+	// relations without tuples, which get no tuples once their incidence
+	// lists are built
+	for (int layout = 0; layout < 3; layout++)
+	{
+		for (int compressed = 0; compressed < 2; compressed++)
+		{
+			char name[64];
+			snprintf(name, sizeof name, "empty%s%s", names[layout], compressed ? "c" : "");
+
+			uint_fast64_t pair[2] = { 1, 2 };
+			CHECK(check_create(&rel, folder, name, layout, 500, 0) == 0);
+			CHECK(slrdata_build_incidence_lists(&rel, &elements, -1) == 0);
+			if (compressed)
+				CHECK(slrdata_compress_incidence_lists(&rel) == 0);
+			CHECK(slrdata_add_tuples(&rel, pair, 1, 2) == -1);
+			check_empty(&rel, 500);
+			slrdata_close(&rel);
+
+			CHECK(slrdata_open(&rel, folder, name, true, true) == 0);
+			CHECK(rel.compressed == compressed);
+			check_empty(&rel, 500);
+			slrdata_close(&rel);
+		}
+	}
+
+	slrdata_close(&elements);
+}
+
+static void check_write(unsigned char *p, int bytes, uint_fast64_t value)
+{
+	for (int i = 0; i < bytes; i++)
+		p[i] = value >> (8 * i);
+}
+
+static void check_write_file(const char *folder, const char *name, const unsigned char *data, size_t size)
+{
+	char path[4096];
+	snprintf(path, sizeof path, "%s/%s.sld", folder, name);
+
+	FILE *f = fopen(path, "wb");
+	CHECK(f != NULL);
+	CHECK(fwrite(data, 1, size, f) == size);
+	CHECK(fclose(f) == 0);
+}
+
+// Files written as version 1 of the format did, with room to spare in the
+// incidence lists, are read and upgraded; files of unknown versions are not
+// opened.
+static void check_versions(const char *base)
+{
+	char folder[4096];
+	CHECK(check_folder(folder, sizeof folder, base, "versions") == 0);
+
+	struct check_relation r;
+	check_generate(&r, 40, 3, 300);
+	check_index(&r);
+
+	// element file: header, element list offset, element list
+	size_t size = 32 + 12 + 6 * r.elements;
+	unsigned char *data = calloc(size, 1);
+	memcpy(data, "slrdata", 8);
+	check_write(data + 8, 8, 1);
+	check_write(data + 16, 8, size);
+	check_write(data + 24, 8, 32);
+	check_write(data + 32, 6, 6 * r.elements);
+	check_write(data + 38, 6, r.elements);
+	for (uint_fast64_t e = 0; e < r.elements; e++)
+		check_write(data + 44 + 6 * e, 6, e + 1);
+	check_write_file(folder, "elements", data, size);
+	free(data);
+
+	// relation file: header, tuple and element list offsets and arity, tuple
+	// list, element list and incidence lists with two free fields each
+	uint_fast64_t tuple_list = 54;
+	uint_fast64_t element_list = tuple_list + 12 + 6 * r.arity * r.count;
+	size = element_list + 12 + 8 * r.elements + r.elements * (12 + 12) + 6 * r.arity * r.count;
+	data = calloc(size, 1);
+	memcpy(data, "slrdatarelation", 16);
+	check_write(data + 16, 8, 1);
+	check_write(data + 24, 8, size);
+	check_write(data + 32, 8, tuple_list);
+	check_write(data + 40, 8, element_list);
+	check_write(data + 48, 6, r.arity);
+	check_write(data + tuple_list, 6, 6 * r.arity * r.count);
+	check_write(data + tuple_list + 6, 6, r.count);
+	for (uint_fast64_t i = 0; i < r.count * r.arity; i++)
+		check_write(data + tuple_list + 12 + 6 * i, 6, r.tuples[i]);
+	check_write(data + element_list, 6, 8 * r.elements);
+	check_write(data + element_list + 6, 6, r.elements);
+	uint_fast64_t list = element_list + 12 + 8 * r.elements;
+	for (uint_fast64_t e = 0; e < r.elements; e++)
+	{
+		uint_fast64_t degree = r.first[e + 1] - r.first[e];
+		check_write(data + element_list + 12 + 8 * e, 8, list);
+		check_write(data + list, 6, 6 * (degree + 2));
+		check_write(data + list + 6, 6, degree);
+		for (uint_fast64_t j = 0; j < degree; j++)
+			check_write(data + list + 12 + 6 * j, 6, r.incidences[r.first[e] + j]);
+		list += 12 + 6 * (degree + 2);
+	}
+	CHECK(list == size);
+	check_write_file(folder, "old", data, size);
+	free(data);
+
+	slrdata_t elements, rel;
+	CHECK(slrdata_open(&elements, folder, "elements", true, false) == 0);
+	CHECK(elements.version == 1 && slrdata_element_count(&elements) == r.elements);
+	CHECK(slrdata_relation_count(&elements) == 0);
+	slrdata_close(&elements);
+
+	CHECK(slrdata_open(&rel, folder, "old", true, true) == 0);
+	CHECK(rel.version == 1);
+	check_relation(&rel, &r, false);
+	slrdata_close(&rel);
+
+	// elements without labels keep version 1, a label upgrades the file
+	CHECK(slrdata_open(&elements, folder, "elements", false, false) == 0);
+	CHECK(slrdata_add_elements(&elements, NULL, 2) == 0);
+	CHECK(elements.version == 1 && slrdata_element_count(&elements) == r.elements + 2);
+	CHECK(slrdata_add_element(&elements, "label") == 0);
+	CHECK(elements.version == 2 && slrdata_element_count(&elements) == r.elements + 3);
+	slrdata_close(&elements);
+
+	CHECK(slrdata_open(&elements, folder, "elements", true, false) == 0);
+	CHECK(elements.version == 2 && slrdata_element_count(&elements) == r.elements + 3);
+	CHECK(slrdata_find_element(&elements, "label", 5) == r.elements + 2);
+	CHECK(slrdata_element_label(&elements, r.elements + 1) == NULL);
+	slrdata_close(&elements);
+
+	// the free fields of the incidence lists are given back
+	CHECK(slrdata_open(&rel, folder, "old", false, true) == 0);
+	CHECK(slrdata_reduce_size(&rel) == 0);
+	CHECK(rel.size == size - 12 * r.elements);
+	check_relation(&rel, &r, false);
+	slrdata_close(&rel);
+
+	unsigned char header[32] = "slrdatarelation";
+	check_write(header + 16, 8, 4);
+	check_write(header + 24, 8, sizeof header);
+	check_write_file(folder, "future", header, sizeof header);
+	CHECK(slrdata_open(&rel, folder, "future", true, true) == -1);
+
+	check_free(&r);
+}
+
+// Sorting, the hash index and the neighbor table of a graph are built in
+// different orders and agree with the tuples after each step
+static void check_graph(const char *base)
+{
+	char folder[4096];
+	CHECK(check_folder(folder, sizeof folder, base, "graph") == 0);
+
+	slrdata_t elements, rel;
+	CHECK(slrdata_create_element_file(&elements, folder) == 0);
+	CHECK(slrdata_add_elements(&elements, NULL, 400) == 0);
+
+	const char *names[] = { "packed", "aligned", "columnar" };
+	for (int layout = 0; layout < 3; layout++)
+	{
+		struct check_relation r;
+		check_generate(&r, 400, 2, 2400);
+		check_index(&r);
+
+		unsigned char *adjacent = calloc(r.elements * r.elements, 1);
+		for (uint_fast64_t i = 0; i < r.count; i++)
+		{
+			uint_fast64_t u = r.tuples[2 * i], v = r.tuples[2 * i + 1];
+			adjacent[u * r.elements + v] = adjacent[v * r.elements + u] = 1;
+		}
+
+		CHECK(check_create(&rel, folder, names[layout], layout, r.elements, r.count) == 0);
+		CHECK(slrdata_add_tuples(&rel, r.tuples, r.count / 2, 2) == 0);
+		// no hash index before the tuple list is final
+		CHECK(slrdata_add_hash_index(&rel) == -1);
+		CHECK(slrdata_add_tuples(&rel, r.tuples + r.count, r.count - r.count / 2, 2) == 0);
+		CHECK(slrdata_build_incidence_lists(&rel, &elements, -1) == 0);
+		CHECK(slrdata_add_hash_index(&rel) == 0);
+		CHECK(slrdata_add_neighbor_table(&rel, 0) == 0);
+		check_relation(&rel, &r, false);
+		check_neighbors(&rel, &r);
+
+		// no more tuples once sections follow the tuple list
+		uint_fast64_t extra[2] = { 1, 2 };
+		CHECK(slrdata_add_tuples(&rel, extra, 1, 2) == -1);
+		CHECK(slrdata_tuple_count(&rel) == r.count);
+
+		CHECK(slrdata_sort_incidence_lists(&rel) == 0);
+		CHECK(rel.sorted);
+		check_relation(&rel, &r, true);
+		check_neighbors(&rel, &r);
+		for (uint_fast64_t u = 0; u < r.elements; u++)
+		{
+			for (uint_fast64_t v = 0; v < r.elements; v++)
+				CHECK(slrdata_adjacent(&rel, u, v) == (adjacent[u * r.elements + v] != 0));
+		}
+
+		uint_fast64_t max_degree = 0;
+		for (uint_fast64_t v = 0; v < r.elements; v++)
+		{
+			if (slrdata_degree(&rel, v) > max_degree)
+				max_degree = slrdata_degree(&rel, v);
+		}
+		CHECK(slrdata_add_neighbor_table(&rel, max_degree - 1) == -1);
+		CHECK(slrdata_add_neighbor_table(&rel, max_degree) == 0);
+		check_neighbors(&rel, &r);
+		slrdata_close(&rel);
+
+		CHECK(slrdata_open(&rel, folder, names[layout], true, true) == 0);
+		CHECK(rel.sorted && rel.hash_index != NULL && rel.neighbors != NULL);
+		check_relation(&rel, &r, true);
+		check_neighbors(&rel, &r);
+		slrdata_close(&rel);
+
+		free(adjacent);
+		check_free(&r);
+	}
+
+	slrdata_close(&elements);
+}
+
+// A relation with a delta segment reads like one built from all its tuples,
+// before and after slrdata_merge_delta, with its compression, sort order,
+// degree table and hash index
+static void check_merge(const char *base)
+{
+	char folder[4096];
+	CHECK(check_folder(folder, sizeof folder, base, "merge") == 0);
+
+	slrdata_t elements, rel;
+	CHECK(slrdata_create_element_file(&elements, folder) == 0);
+	CHECK(slrdata_add_elements(&elements, NULL, 300) == 0);
+
+	const char *names[] = { "plain", "compressed", "sorted", "indexed" };
+	for (int mode = 0; mode < 4; mode++)
+	{
+		struct check_relation r;
+		check_generate(&r, 300 + 20 * (mode + 1), 2, 3000);
+		uint_fast64_t base_count = 2000;
+		for (uint_fast64_t i = 0; i < 2 * base_count; i++)
+			r.tuples[i] %= 300;
+
+		CHECK(slrdata_create_relation_file(&rel, folder, names[mode]) == 0);
+		CHECK(slrdata_add_tuples(&rel, r.tuples, base_count, 2) == 0);
+		CHECK(slrdata_build_incidence_lists(&rel, &elements, -1) == 0);
+		if (mode == 1)
+			CHECK(slrdata_compress_incidence_lists(&rel) == 0);
+		if (mode == 2)
+			CHECK(slrdata_sort_incidence_lists(&rel) == 0);
+		if (mode == 3)
+		{
+			CHECK(slrdata_add_degree_table(&rel) == 0);
+			CHECK(slrdata_add_hash_index(&rel) == 0);
+		}
+
+		CHECK(slrdata_add_elements(&elements, NULL, 20) == 0);
+		for (uint_fast64_t at = base_count, step = 1; at < r.count; at += step, step *= 3)
+		{
+			if (at + step > r.count)
+				step = r.count - at;
+			CHECK(slrdata_add_delta_tuples(&rel, r.tuples + 2 * at, step, 2) == 0);
+		}
+		CHECK(rel.delta_count == r.count - base_count);
+		check_index(&r);
+		check_relation(&rel, &r, mode == 2);
+
+		// a degree bound the merged lists exceed leaves the relation as it was
+		CHECK(slrdata_merge_delta(&rel, &elements, 1) == -1);
+		CHECK(rel.delta_count == r.count - base_count);
+		check_relation(&rel, &r, mode == 2);
+
+		CHECK(slrdata_merge_delta(&rel, &elements, -1) == 0);
+		CHECK(rel.delta == NULL && rel.delta_count == 0);
+		CHECK(rel.compressed == (mode == 1) && rel.sorted == (mode == 2));
+		CHECK((rel.degree_table != NULL) == (mode == 3) && (rel.hash_index != NULL) == (mode == 3));
+		check_relation(&rel, &r, mode == 2);
+		slrdata_close(&rel);
+
+		CHECK(slrdata_open(&rel, folder, names[mode], true, true) == 0);
+		check_relation(&rel, &r, mode == 2);
+		slrdata_close(&rel);
+
+		check_free(&r);
+	}
+
+	slrdata_close(&elements);
+}
+
+// element labels and the catalog of relations of a database
+static void check_database(const char *base)
+{
+	char folder[4096];
+	CHECK(check_folder(folder, sizeof folder, base, "database") == 0);
+
+	slrdata_t elements, rel;
+	CHECK(slrdata_create_element_file(&elements, folder) == 0);
+	const char *labels[] = { "a", NULL, "b", "a" };
+	CHECK(slrdata_add_elements(&elements, labels, 4) == 0);
+	char label[32];
+	for (int i = 0; i < 3000; i++)
+	{
+		snprintf(label, sizeof label, "element-%d", i);
+		CHECK(slrdata_add_element(&elements, label) == 0);
+	}
+
+	CHECK(slrdata_element_count(&elements) == 3004);
+	CHECK(slrdata_find_element(&elements, "a", 1) == 0);
+	CHECK(slrdata_find_element(&elements, "b", 1) == 2);
+	CHECK(slrdata_find_element(&elements, "c", 1) == (uint_fast64_t)-1);
+	CHECK(slrdata_element_label(&elements, 1) == NULL);
+	CHECK(strcmp(slrdata_element_label(&elements, 3), "a") == 0);
+
+	struct check_relation r[2];
+	const char *names[] = { "binary", "ternary" };
+	for (int k = 0; k < 2; k++)
+	{
+		check_generate(&r[k], 3004, 2 + k, 5000);
+		check_index(&r[k]);
+		CHECK(slrdata_create_relation_file(&rel, folder, names[k]) == 0);
+		CHECK(slrdata_add_tuples(&rel, r[k].tuples, r[k].count, r[k].arity) == 0);
+		CHECK(slrdata_build_incidence_lists(&rel, &elements, -1) == 0);
+		CHECK(slrdata_add_relation(&elements, &rel) == 0);
+		CHECK(slrdata_add_relation(&elements, &rel) == 0);
+		slrdata_close(&rel);
+	}
+	CHECK(slrdata_relation_count(&elements) == 2);
+
+	struct slrdata_relation_info info;
+	CHECK(slrdata_relation_info(&elements, 1, &info) == 0);
+	CHECK(strcmp(info.name, "ternary") == 0 && info.arity == 3 && info.tuple_count == 5000);
+	CHECK(slrdata_relation_info(&elements, 2, &info) == -1);
+	slrdata_close(&elements);
+
+	// closing gives back the room the element file had to grow
+	CHECK(slrdata_open(&elements, folder, "elements", true, false) == 0);
+	CHECK(check_file_size(&elements) == elements.size);
+	slrdata_close(&elements);
+
+	slrdata_database_t db;
+	CHECK(slrdata_open_database(&db, folder, true, 0) == 0);
+	CHECK(db.relation_count == 2 && slrdata_element_count(&db.elements) == 3004);
+	for (int i = 0; i < 3000; i += 17)
+	{
+		snprintf(label, sizeof label, "element-%d", i);
+		CHECK(slrdata_find_element(&db.elements, label, strlen(label)) == (uint_fast64_t)i + 4);
+		CHECK(strcmp(slrdata_element_label(&db.elements, i + 4), label) == 0);
+	}
+	for (int k = 0; k < 2; k++)
+	{
+		slrdata_t *found = slrdata_database_relation(&db, names[k]);
+		CHECK(found != NULL);
+		check_relation(found, &r[k], false);
+		check_free(&r[k]);
+	}
+	CHECK(slrdata_database_relation(&db, "missing") == NULL);
+	slrdata_close_database(&db);
+}
+
+// Imports of text with element ids and with labels, with the pairs spilled to
+// many runs, and a failed import that leaves the element file as it was
+static void check_import(const char *base)
+{
+	char folder[4096], path[4096 + 16];
+	CHECK(check_folder(folder, sizeof folder, base, "import") == 0);
+
+	// more runs than are merged at a time
+	struct check_relation r;
+	check_generate(&r, 300, 2, 40000);
+	r.elements = 0;
+	for (uint_fast64_t i = 0; i < r.count * r.arity; i++)
+	{
+		if (r.tuples[i] >= r.elements)
+			r.elements = r.tuples[i] + 1;
+	}
+	check_index(&r);
+
+	snprintf(path, sizeof path, "%s/ids.txt", folder);
+	FILE *f = fopen(path, "w");
+	CHECK(f != NULL);
+	fprintf(f, "# element ids\n");
+	for (uint_fast64_t i = 0; i < r.count; i++)
+		fprintf(f, "%lu\t%lu\n", (unsigned long)r.tuples[2 * i], (unsigned long)r.tuples[2 * i + 1]);
+	CHECK(fclose(f) == 0);
+
+	// the least memory the importer takes, 1024 pairs per run
+	struct slrdata_import_options options = { .memory = 0 };
+	CHECK((f = fopen(path, "r")) != NULL);
+	CHECK(slrdata_import(f, folder, "ids", &options) == 0);
+	fclose(f);
+
+	slrdata_t elements, rel;
+	CHECK(slrdata_open(&rel, folder, "ids", true, true) == 0);
+	check_relation(&rel, &r, false);
+	slrdata_close(&rel);
+
+	// labels, numbered in order of first appearance after the elements
+	snprintf(path, sizeof path, "%s/labels.csv", folder);
+	CHECK((f = fopen(path, "w")) != NULL);
+	for (uint_fast64_t i = 0; i < r.count; i++)
+		fprintf(f, "v%lu,v%lu\n", (unsigned long)r.tuples[2 * i], (unsigned long)r.tuples[2 * i + 1]);
+	CHECK(fclose(f) == 0);
+
+	options = (struct slrdata_import_options){ .delimiter = ',', .labels = true, .memory = 1 << 14 };
+	CHECK((f = fopen(path, "r")) != NULL);
+	CHECK(slrdata_import(f, folder, "labels", &options) == 0);
+	fclose(f);
+
+	CHECK(slrdata_open(&elements, folder, "elements", true, false) == 0);
+	CHECK(slrdata_element_count(&elements) == 2 * r.elements);
+	CHECK(slrdata_relation_count(&elements) == 2);
+	CHECK(slrdata_open(&rel, folder, "labels", true, true) == 0);
+	CHECK(slrdata_tuple_count(&rel) == r.count);
+	for (uint_fast64_t i = 0; i < r.count; i++)
+	{
+		uint_fast64_t tuple[2];
+		char label[32];
+		CHECK(slrdata_read_ith_tuple(&rel, i, tuple) == 0);
+		for (int j = 0; j < 2; j++)
+		{
+			snprintf(label, sizeof label, "v%lu", (unsigned long)r.tuples[2 * i + j]);
+			CHECK(strcmp(slrdata_element_label(&elements, tuple[j]), label) == 0);
+			CHECK(slrdata_find_element(&elements, label, strlen(label)) == tuple[j]);
+		}
+	}
+	for (uint_fast64_t v = 0; v < r.elements; v++)
+	{
+		char label[32];
+		snprintf(label, sizeof label, "v%lu", (unsigned long)v);
+		uint_fast64_t id = slrdata_find_element(&elements, label, strlen(label));
+		CHECK(id >= r.elements && slrdata_degree(&rel, id) == r.first[v + 1] - r.first[v]);
+	}
+	slrdata_close(&rel);
+	slrdata_close(&elements);
+
+	// a degree bound fails the import, new labels do not stay behind
+	snprintf(path, sizeof path, "%s/bounded.txt", folder);
+	CHECK((f = fopen(path, "w")) != NULL);
+	fprintf(f, "v1 new1\nv1 new2\n");
+	CHECK(fclose(f) == 0);
+
+	options = (struct slrdata_import_options){ .labels = true, .max_degree = 1 };
+	CHECK((f = fopen(path, "r")) != NULL);
+	CHECK(slrdata_import(f, folder, "bounded", &options) == -1);
+	fclose(f);
+	CHECK(slrdata_open(&rel, folder, "bounded", true, true) == -1);
+
+	CHECK(slrdata_open(&elements, folder, "elements", false, false) == 0);
+	CHECK(slrdata_element_count(&elements) == 2 * r.elements);
+	CHECK(slrdata_relation_count(&elements) == 2);
+	CHECK(slrdata_find_element(&elements, "new1", 4) == (uint_fast64_t)-1);
+	CHECK(slrdata_find_element(&elements, "v1", 2) != (uint_fast64_t)-1);
+	CHECK(slrdata_element_label(&elements, 2 * r.elements) == NULL);
+	CHECK(slrdata_add_element(&elements, "new2") == 0);
+	CHECK(slrdata_find_element(&elements, "new2", 4) == 2 * r.elements);
+	slrdata_close(&elements);
+
+	check_free(&r);
+}
+
+// The parallel build writes the same file as the serial one for any number of
+// threads, also when there are too many elements for all threads to get counts
+static void check_parallel_build(const char *base)
+{
+	char folder[4096];
+	CHECK(check_folder(folder, sizeof folder, base, "parallel") == 0);
+
+	const uint_fast64_t element_counts[] = { 20000, 800000 };
+	const char *names[] = { "packed", "aligned", "columnar" };
+	for (int k = 0; k < 2; k++)
+	{
+		slrdata_t elements, serial, rel;
+		char elements_folder[4096 + 16];
+		snprintf(elements_folder, sizeof elements_folder, "%s/%d", folder, k);
+		CHECK(slrdata_create_directory(elements_folder) == 0);
+		CHECK(slrdata_create_element_file(&elements, elements_folder) == 0);
+		CHECK(slrdata_add_elements(&elements, NULL, element_counts[k]) == 0);
+
+		// enough incidences for the parallel build not to fall back
+		struct check_relation r;
+		check_generate(&r, element_counts[k], 2, 600000);
+
+		for (int layout = 0; layout < 3; layout++)
+		{
+			CHECK(check_create(&serial, elements_folder, names[layout], layout, r.elements, r.count) == 0);
+			CHECK(slrdata_add_tuples(&serial, r.tuples, r.count, 2) == 0);
+			CHECK(slrdata_build_incidence_lists(&serial, &elements, -1) == 0);
+
+			for (unsigned threads = 2; threads <= 8; threads *= 2)
+			{
+				char name[64];
+				snprintf(name, sizeof name, "%s%u", names[layout], threads);
+				CHECK(check_create(&rel, elements_folder, name, layout, r.elements, r.count) == 0);
+				CHECK(slrdata_add_tuples(&rel, r.tuples, r.count, 2) == 0);
+				CHECK(slrdata_build_incidence_lists_parallel(&rel, &elements, -1, threads) == 0);
+				CHECK(rel.size == serial.size && memcmp(rel.ptr, serial.ptr, rel.size) == 0);
+				slrdata_close(&rel);
+			}
+			slrdata_close(&serial);
+		}
+
+		check_free(&r);
+		slrdata_close(&elements);
+	}
+}
+
+// Samples are in range and read the tuples they name, and the _r functions
+// draw what the handle draws from the same seed
+static void check_sampling(const char *base)
+{
+	char folder[4096];
+	CHECK(check_folder(folder, sizeof folder, base, "sampling") == 0);
+
+	// the last elements are in no tuple
+	slrdata_t elements, rel;
+	CHECK(slrdata_create_element_file(&elements, folder) == 0);
+	CHECK(slrdata_add_elements(&elements, NULL, 520) == 0);
+
+	slrdata_seed(&elements, 1);
+	uint64_t rng[4];
+	slrdata_seed_r(rng, 1);
+	uint_fast64_t sampled[2000], drawn[2000];
+	for (int j = 0; j < 2000; j++)
+	{
+		sampled[j] = slrdata_sample_element(&elements);
+		CHECK(sampled[j] < 520);
+	}
+	slrdata_sample_elements_r(&elements, rng, drawn, 2000);
+	CHECK(memcmp(sampled, drawn, sizeof sampled) == 0);
+
+	const char *names[] = { "packed", "compressed", "columnar" };
+	for (int mode = 0; mode < 3; mode++)
+	{
+		struct check_relation r;
+		check_generate(&r, 500, 3, 4000);
+		check_index(&r);
+
+		CHECK(check_create(&rel, folder, names[mode], mode == 2 ? 2 : 0, 520, r.count) == 0);
+		CHECK(slrdata_add_tuples(&rel, r.tuples, r.count, 3) == 0);
+		CHECK(slrdata_build_incidence_lists(&rel, &elements, -1) == 0);
+		if (mode == 1)
+			CHECK(slrdata_compress_incidence_lists(&rel) == 0);
+
+		uint_fast64_t tuple[3], tuples[3 * 1000];
+		slrdata_seed(&rel, 2);
+		slrdata_seed_r(rng, 2);
+		for (int j = 0; j < 1000; j++)
+		{
+			uint_fast64_t i = slrdata_sample_tuple(&rel, tuple);
+			CHECK(i < r.count);
+			CHECK(memcmp(tuple, r.tuples + i * 3, sizeof tuple) == 0);
+			memcpy(tuples + 3 * j, tuple, sizeof tuple);
+		}
+		uint_fast64_t *more = malloc(3 * 1000 * sizeof(uint_fast64_t));
+		CHECK(slrdata_sample_tuples_r(&rel, rng, more, 1000) == 0);
+		CHECK(memcmp(tuples, more, sizeof tuples) == 0);
+
+		for (uint_fast64_t e = 0; e < 520; e++)
+		{
+			uint_fast64_t degree = e < 500 ? r.first[e + 1] - r.first[e] : 0;
+			if (degree == 0)
+			{
+				CHECK(slrdata_sample_incidence(&rel, e, tuple) == (uint_fast64_t)-1);
+				CHECK(slrdata_sample_incidences(&rel, e, tuples, 1) == -1);
+				continue;
+			}
+
+			slrdata_seed(&rel, e);
+			slrdata_seed_r(rng, e);
+			for (int j = 0; j < 40; j++)
+			{
+				uint_fast64_t i = slrdata_sample_incidence(&rel, e, tuple);
+				CHECK(i < degree);
+				CHECK(memcmp(tuple, r.tuples + r.incidences[r.first[e] + i] * 3, sizeof tuple) == 0);
+				memcpy(tuples + 3 * j, tuple, sizeof tuple);
+			}
+			CHECK(slrdata_sample_incidences_r(&rel, rng, e, more, 40) == 0);
+			CHECK(memcmp(tuples, more, 3 * 40 * sizeof(uint_fast64_t)) == 0);
+		}
+
+		free(more);
+		slrdata_close(&rel);
+		check_free(&r);
+	}
+
+	slrdata_close(&elements);
+}
+
+// Elements drawn by degree come from the degree table in proportion to their
+// degree, elements in no tuple never, also after opening the relation again
+static void check_degree_table(const char *base)
+{
+	char folder[4096];
+	CHECK(check_folder(folder, sizeof folder, base, "degree-table") == 0);
+
+	slrdata_t elements, rel;
+	CHECK(slrdata_create_element_file(&elements, folder) == 0);
+	CHECK(slrdata_add_elements(&elements, NULL, 520) == 0);
+
+	// skewed degrees over the first 500 elements
+	struct check_relation r;
+	check_generate(&r, 500, 2, 20000);
+	for (uint_fast64_t i = 0; i < r.count * r.arity; i++)
+		r.tuples[i] = r.tuples[i] * r.tuples[i] / 500;
+	check_index(&r);
+
+	CHECK(slrdata_create_relation_file(&rel, folder, "skewed") == 0);
+	CHECK(slrdata_add_tuples(&rel, r.tuples, r.count, 2) == 0);
+	CHECK(slrdata_build_incidence_lists(&rel, &elements, -1) == 0);
+	CHECK(slrdata_sample_element_by_degree(&rel) == (uint_fast64_t)-1);
+	CHECK(slrdata_add_degree_table(&rel) == 0);
+	slrdata_close(&rel);
+
+	CHECK(slrdata_open(&rel, folder, "skewed", true, true) == 0);
+	CHECK(rel.degree_table != NULL);
+
+	// the number of draws of every element is within 6 standard deviations
+	// of its expectation
+	const uint_fast64_t draws = 400000;
+	uint_fast64_t *counts = calloc(520, sizeof(uint_fast64_t));
+	uint_fast64_t *drawn = malloc(draws * sizeof(uint_fast64_t));
+	CHECK(slrdata_sample_elements_by_degree(&rel, drawn, draws) == 0);
+	for (uint_fast64_t j = 0; j < draws; j++)
+	{
+		CHECK(drawn[j] < 520);
+		counts[drawn[j]]++;
+	}
+	for (uint_fast64_t e = 0; e < 520; e++)
+	{
+		double expected = e < 500 ? (double)draws * (r.first[e + 1] - r.first[e]) / (r.count * r.arity) : 0;
+		double d = counts[e] - expected;
+		CHECK(d * d <= 36 * expected);
+	}
+
+	// the handle and the _r function draw the same from the same seed
+	uint64_t rng[4];
+	slrdata_seed(&rel, 3);
+	slrdata_seed_r(rng, 3);
+	for (uint_fast64_t j = 0; j < 520; j++)
+		counts[j] = slrdata_sample_element_by_degree(&rel);
+	CHECK(slrdata_sample_elements_by_degree_r(&rel, rng, drawn, 520) == 0);
+	CHECK(memcmp(counts, drawn, 520 * sizeof(uint_fast64_t)) == 0);
+
+	free(drawn);
+	free(counts);
+	slrdata_close(&rel);
+	check_free(&r);
+	slrdata_close(&elements);
+}
+
+// Relations opened with every hint answer queries as without, warming up
+// reads at least the element list and degree table, and the hints of a
+// writable handle survive the remaps of growing it
+static void check_hints(const char *base)
+{
+	char folder[4096];
+	CHECK(check_folder(folder, sizeof folder, base, "hints") == 0);
+
+	slrdata_t elements, rel;
+	CHECK(slrdata_create_element_file(&elements, folder) == 0);
+	CHECK(slrdata_add_elements(&elements, NULL, 400) == 0);
+
+	struct check_relation r;
+	check_generate(&r, 400, 2, 6000);
+	uint_fast64_t base_count = 3000;
+	CHECK(slrdata_create_relation_file(&rel, folder, "hinted") == 0);
+	CHECK(slrdata_add_tuples(&rel, r.tuples, base_count, 2) == 0);
+	CHECK(slrdata_build_incidence_lists(&rel, &elements, -1) == 0);
+	CHECK(slrdata_add_degree_table(&rel) == 0);
+	CHECK(slrdata_add_hash_index(&rel) == 0);
+	slrdata_close(&rel);
+
+	// the tuples before the delta segment, sharing the tuples of r
+	struct check_relation first = r;
+	first.count = base_count;
+	check_index(&first);
+
+	const unsigned hints[] = { 0, SLRDATA_HINT_RANDOM, SLRDATA_HINT_SEQUENTIAL, SLRDATA_HINT_POPULATE,
+		SLRDATA_HINT_HUGEPAGES, SLRDATA_HINT_LOCK, SLRDATA_HINT_RANDOM | SLRDATA_HINT_POPULATE | SLRDATA_HINT_LOCK };
+	for (unsigned h = 0; h < sizeof(hints) / sizeof(hints[0]); h++)
+	{
+		CHECK(slrdata_open_hinted(&rel, folder, "hinted", true, true, hints[h]) == 0);
+		CHECK(rel.hints == hints[h]);
+		CHECK(slrdata_warm_up(&rel) >= 12 + 8 * 400 + 8 + 16 * 400);
+		check_relation(&rel, &first, false);
+
+		CHECK(slrdata_advise(&rel, SLRDATA_HINT_SEQUENTIAL) == 0);
+		CHECK(rel.hints == SLRDATA_HINT_SEQUENTIAL);
+		check_relation(&rel, &first, false);
+		slrdata_close(&rel);
+	}
+
+	CHECK(slrdata_open_hinted(&rel, folder, "hinted", false, true, SLRDATA_HINT_RANDOM | SLRDATA_HINT_LOCK) == 0);
+	for (uint_fast64_t at = base_count; at < r.count; at += 500)
+		CHECK(slrdata_add_delta_tuples(&rel, r.tuples + 2 * at, 500, 2) == 0);
+	CHECK(rel.hints == (SLRDATA_HINT_RANDOM | SLRDATA_HINT_LOCK));
+	check_index(&r);
+	check_relation(&rel, &r, false);
+	slrdata_close(&rel);
+
+	free(first.first);
+	free(first.incidences);
+	check_free(&r);
+	slrdata_close(&elements);
+}
+
+// Batched reads and degrees, out of range requests among them, give what the
+// single queries give, also with compressed lists and a delta segment
+static void check_batches(const char *base)
+{
+	char folder[4096];
+	CHECK(check_folder(folder, sizeof folder, base, "batches") == 0);
+
+	slrdata_t elements, rel;
+	CHECK(slrdata_create_element_file(&elements, folder) == 0);
+	CHECK(slrdata_add_elements(&elements, NULL, 300) == 0);
+
+	const uint_fast64_t count = 3000;
+	uint_fast64_t *requested = malloc(count * sizeof(uint_fast64_t));
+	uint_fast64_t *indices = malloc(count * sizeof(uint_fast64_t));
+	uint_fast64_t *degrees = malloc(count * sizeof(uint_fast64_t));
+	uint_fast64_t *tuples = malloc(3 * count * sizeof(uint_fast64_t));
+	uint_fast64_t tuple[3];
+
+	const char *names[] = { "packed", "compressed", "columnar", "delta" };
+	for (int mode = 0; mode < 4; mode++)
+	{
+		struct check_relation r;
+		check_generate(&r, mode == 3 ? 320 : 300, 3, 5000);
+		uint_fast64_t base_count = mode == 3 ? 4000 : r.count;
+		for (uint_fast64_t i = 0; i < 3 * base_count; i++)
+			r.tuples[i] %= 300;
+
+		CHECK(check_create(&rel, folder, names[mode], mode == 2 ? 2 : 0, 300, base_count) == 0);
+		CHECK(slrdata_add_tuples(&rel, r.tuples, base_count, 3) == 0);
+		CHECK(slrdata_build_incidence_lists(&rel, &elements, -1) == 0);
+		if (mode == 1)
+			CHECK(slrdata_compress_incidence_lists(&rel) == 0);
+		if (mode == 3)
+			CHECK(slrdata_add_delta_tuples(&rel, r.tuples + 3 * base_count, r.count - base_count, 3) == 0);
+
+		// elements past the last one and indices past the degree
+		for (uint_fast64_t j = 0; j < count; j++)
+		{
+			requested[j] = check_random() % (r.elements + 10);
+			uint_fast64_t degree = slrdata_degree(&rel, requested[j]);
+			indices[j] = check_random() % (degree + 2);
+		}
+
+		bool failed = false;
+		int ret = slrdata_read_tuples(&rel, requested, indices, count, tuples);
+		for (uint_fast64_t j = 0; j < count; j++)
+		{
+			if (slrdata_read_tuple(&rel, requested[j], indices[j], tuple))
+			{
+				failed = true;
+				for (int a = 0; a < 3; a++)
+					CHECK(tuples[3 * j + a] == (uint_fast64_t)-1);
+			}
+			else
+			{
+				CHECK(memcmp(tuples + 3 * j, tuple, sizeof tuple) == 0);
+			}
+		}
+		CHECK(failed && ret == -1);
+
+		for (uint_fast64_t j = 0; j < count; j++)
+			indices[j] = check_random() % (r.count + r.count / 100);
+
+		failed = false;
+		ret = slrdata_read_ith_tuples(&rel, indices, count, tuples);
+		for (uint_fast64_t j = 0; j < count; j++)
+		{
+			if (slrdata_read_ith_tuple(&rel, indices[j], tuple))
+			{
+				failed = true;
+				for (int a = 0; a < 3; a++)
+					CHECK(tuples[3 * j + a] == (uint_fast64_t)-1);
+			}
+			else
+			{
+				CHECK(memcmp(tuples + 3 * j, tuple, sizeof tuple) == 0);
+			}
+		}
+		CHECK(failed && ret == -1);
+
+		// requests all in range succeed
+		for (uint_fast64_t j = 0; j < count; j++)
+			indices[j] %= r.count;
+		CHECK(slrdata_read_ith_tuples(&rel, indices, count, tuples) == 0);
+		for (uint_fast64_t j = 0; j < count; j++)
+			CHECK(memcmp(tuples + 3 * j, r.tuples + 3 * indices[j], sizeof tuple) == 0);
+
+		slrdata_degrees(&rel, requested, count, degrees);
+		for (uint_fast64_t j = 0; j < count; j++)
+			CHECK(degrees[j] == slrdata_degree(&rel, requested[j]));
+
+		slrdata_close(&rel);
+		check_free(&r);
+	}
+
+	free(requested);
+	free(indices);
+	free(degrees);
+	free(tuples);
+	slrdata_close(&elements);
+}
+
+// Queries spread over the pool give what the batched ones give, and samples
+// drawn by the pool depend on the seed only, not on the number of threads
+static void check_pool(const char *base)
+{
+	char folder[4096];
+	CHECK(check_folder(folder, sizeof folder, base, "pool") == 0);
+
+	// the last elements are in no tuple
+	slrdata_t elements, rel;
+	CHECK(slrdata_create_element_file(&elements, folder) == 0);
+	CHECK(slrdata_add_elements(&elements, NULL, 2100) == 0);
+
+	struct check_relation r;
+	check_generate(&r, 2000, 2, 40000);
+	CHECK(slrdata_create_relation_file(&rel, folder, "pooled") == 0);
+	CHECK(slrdata_add_tuples(&rel, r.tuples, r.count, 2) == 0);
+	CHECK(slrdata_build_incidence_lists(&rel, &elements, -1) == 0);
+	slrdata_close(&rel);
+	CHECK(slrdata_open(&rel, folder, "pooled", true, true) == 0);
+
+	// enough requests for many chunks per thread
+	const uint_fast64_t count = 50000;
+	uint_fast64_t *requested = malloc(count * sizeof(uint_fast64_t));
+	uint_fast64_t *indices = malloc(count * sizeof(uint_fast64_t));
+	uint_fast64_t *expected = malloc(2 * count * sizeof(uint_fast64_t));
+	uint_fast64_t *tuples = malloc(2 * count * sizeof(uint_fast64_t));
+	for (uint_fast64_t j = 0; j < count; j++)
+	{
+		requested[j] = check_random() % 2000;
+		indices[j] = check_random() % (slrdata_degree(&rel, requested[j]) + 1);
+	}
+
+	int ret = slrdata_read_tuples(&rel, requested, indices, count, expected);
+	for (unsigned threads = 1; threads <= 8; threads *= 2)
+	{
+		CHECK(slrdata_parallel_read_tuples(&rel, requested, indices, count, tuples, threads) == ret);
+		CHECK(memcmp(tuples, expected, 2 * count * sizeof(uint_fast64_t)) == 0);
+	}
+
+	for (uint_fast64_t j = 0; j < count; j++)
+		indices[j] = check_random() % r.count;
+	CHECK(slrdata_read_ith_tuples(&rel, indices, count, expected) == 0);
+	for (unsigned threads = 1; threads <= 8; threads *= 2)
+	{
+		CHECK(slrdata_parallel_read_ith_tuples(&rel, indices, count, tuples, threads) == 0);
+		CHECK(memcmp(tuples, expected, 2 * count * sizeof(uint_fast64_t)) == 0);
+	}
+
+	// the generator of the handle is left alone
+	uint64_t rng[4];
+	memcpy(rng, rel.rng, sizeof rng);
+
+	CHECK(slrdata_parallel_sample_tuples(&rel, 5, expected, count, 1) == 0);
+	for (uint_fast64_t j = 0; j < count; j++)
+		CHECK(slrdata_has_tuple(&rel, expected + 2 * j));
+	for (unsigned threads = 2; threads <= 8; threads *= 2)
+	{
+		CHECK(slrdata_parallel_sample_tuples(&rel, 5, tuples, count, threads) == 0);
+		CHECK(memcmp(tuples, expected, 2 * count * sizeof(uint_fast64_t)) == 0);
+	}
+	CHECK(slrdata_parallel_sample_tuples(&rel, 6, tuples, count, 4) == 0);
+	CHECK(memcmp(tuples, expected, 2 * count * sizeof(uint_fast64_t)) != 0);
+
+	// elements in no tuple get tuples of -1
+	for (uint_fast64_t j = 0; j < count; j++)
+		requested[j] = check_random() % 2100;
+	CHECK(slrdata_parallel_sample_incidences(&rel, 5, requested, count, expected, 1) == -1);
+	for (uint_fast64_t j = 0; j < count; j++)
+	{
+		if (requested[j] >= 2000 || slrdata_degree(&rel, requested[j]) == 0)
+			CHECK(expected[2 * j] == (uint_fast64_t)-1 && expected[2 * j + 1] == (uint_fast64_t)-1);
+		else
+			CHECK(expected[2 * j] == requested[j] || expected[2 * j + 1] == requested[j]);
+	}
+	for (unsigned threads = 2; threads <= 8; threads *= 2)
+	{
+		CHECK(slrdata_parallel_sample_incidences(&rel, 5, requested, count, tuples, threads) == -1);
+		CHECK(memcmp(tuples, expected, 2 * count * sizeof(uint_fast64_t)) == 0);
+	}
+	CHECK(memcmp(rng, rel.rng, sizeof rng) == 0);
+
+	free(requested);
+	free(indices);
+	free(expected);
+	free(tuples);
+	slrdata_close(&rel);
+	check_free(&r);
+	slrdata_close(&elements);
+}
+
+// With the library built with SLRDATA_STATS, the statistics count queries and
+// file growth and are dumped as JSON; without it they cannot be enabled
+static void check_stats(const char *base)
+{
+	char folder[4096];
+	CHECK(check_folder(folder, sizeof folder, base, "stats") == 0);
+
+	slrdata_t elements, rel;
+	CHECK(slrdata_create_element_file(&elements, folder) == 0);
+	CHECK(slrdata_add_elements(&elements, NULL, 200) == 0);
+	CHECK(slrdata_create_relation_file(&rel, folder, "counted") == 0);
+
+	if (slrdata_stats_enable(&rel))
+	{
+		CHECK(rel.stats == NULL);
+		CHECK(slrdata_stats_dump(&rel, stdout) == -1);
+		slrdata_close(&rel);
+		slrdata_close(&elements);
+		return;
+	}
+
+	struct check_relation r;
+	check_generate(&r, 200, 2, 20000);
+	CHECK(slrdata_add_tuples(&rel, r.tuples, r.count, 2) == 0);
+	CHECK(slrdata_build_incidence_lists(&rel, &elements, -1) == 0);
+	CHECK(rel.stats->resizes > 0 && rel.stats->remaps > 0 && rel.stats->remapped_bytes > 0);
+
+	// every call is counted, one in SLRDATA_STATS_SAMPLE timed
+	CHECK(slrdata_stats_enable(&rel) == 0);
+	CHECK(rel.stats->resizes == 0 && rel.stats->calls[SLRDATA_STAT_DEGREE] == 0);
+	for (uint_fast64_t e = 0; e < 130; e++)
+		slrdata_degree(&rel, e);
+	uint_fast64_t indices[1000], tuples[2 * 1000];
+	for (int j = 0; j < 1000; j++)
+		indices[j] = j;
+	CHECK(slrdata_read_ith_tuples(&rel, indices, 1000, tuples) == 0);
+
+	CHECK(rel.stats->calls[SLRDATA_STAT_DEGREE] == 130 && rel.stats->queries[SLRDATA_STAT_DEGREE] == 130);
+	CHECK(rel.stats->calls[SLRDATA_STAT_BATCH] == 1 && rel.stats->queries[SLRDATA_STAT_BATCH] == 1000);
+	uint64_t timed = 0;
+	for (int b = 0; b < SLRDATA_STAT_BUCKETS; b++)
+		timed += rel.stats->latency[SLRDATA_STAT_DEGREE][b];
+	CHECK(timed == 3);
+
+	FILE *f = tmpfile();
+	CHECK(f != NULL);
+	CHECK(slrdata_stats_dump(&rel, f) == 0);
+	char dump[4096];
+	rewind(f);
+	size_t length = fread(dump, 1, sizeof dump - 1, f);
+	dump[length] = 0;
+	fclose(f);
+	CHECK(length > 2 && dump[0] == '{' && strcmp(dump + length - 2, "}}") == 0);
+	CHECK(strstr(dump, "\"degree\": {\"calls\": 130, \"requests\": 130, ") != NULL);
+	CHECK(strstr(dump, "\"batch\": {\"calls\": 1, \"requests\": 1000, ") != NULL);
+
+	slrdata_close(&rel);
+	CHECK(rel.stats == NULL);
+	check_free(&r);
+	slrdata_close(&elements);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 2)
+	{
+		fprintf(stderr, "usage: %s folder\n", argv[0]);
+		return 1;
+	}
+
+	CHECK(slrdata_create_directory(argv[1]) == 0);
+
+	check_round_trip(argv[1]);
+	check_parallel_build(argv[1]);
+	check_versions(argv[1]);
+	check_graph(argv[1]);
+	check_merge(argv[1]);
+	check_database(argv[1]);
+	check_import(argv[1]);
+	check_sampling(argv[1]);
+	check_degree_table(argv[1]);
+	check_hints(argv[1]);
+	check_batches(argv[1]);
+	check_pool(argv[1]);
+	check_stats(argv[1]);
+
+	printf("all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,80 @@
+#include "../include/sl-relational-data.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-d delimiter] [-a arity] [-b] [-l] [-m MiB] [-D max_degree] folder relation [input]\n"
+			"  -d  field delimiter of text input (default spaces and tabs)\n"
+			"  -a  arity (default number of fields on the first line)\n"
+			"  -b  binary input of little endian 64 bit element ids, needs -a\n"
+			"  -l  fields are labels instead of element ids\n"
+			"  -m  memory for sorting in MiB (default 1024)\n"
+			"  -D  maximum degree of an element (default none)\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	struct slrdata_import_options options = {
+		.arity = 0,
+		.delimiter = 0,
+		.binary = false,
+		.labels = false,
+		.memory = (size_t)1024 << 20,
+		.max_degree = 0,
+	};
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:a:blm:D:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'd':
+			options.delimiter = optarg[0] == '\\' && optarg[1] == 't' ? '\t' : optarg[0];
+			break;
+		case 'a':
+			options.arity = strtoull(optarg, NULL, 10);
+			break;
+		case 'b':
+			options.binary = true;
+			break;
+		case 'l':
+			options.labels = true;
+			break;
+		case 'm':
+			options.memory = (size_t)strtoull(optarg, NULL, 10) << 20;
+			break;
+		case 'D':
+			options.max_degree = strtoull(optarg, NULL, 10);
+			break;
+		default:
+			usage(argv[0]);
+			return(2);
+		}
+	}
+
+	if (argc - optind < 2 || argc - optind > 3 || (options.binary && (options.arity == 0 || options.labels)))
+	{
+		usage(argv[0]);
+		return(2);
+	}
+
+	FILE *in = stdin;
+	if (argc - optind == 3 && (in = fopen(argv[optind + 2], options.binary ? "rb" : "r")) == NULL)
+	{
+		perror(argv[optind + 2]);
+		return(1);
+	}
+
+	if (slrdata_import(in, argv[optind], argv[optind + 1], &options))
+	{
+		fprintf(stderr, "%s: could not import %s/%s\n", argv[0], argv[optind], argv[optind + 1]);
+		return(1);
+	}
+
+	if (in != stdin)
+		fclose(in);
+
+	return(0);
+}